@@ -0,0 +1,95 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include <QQuickWindow>
+#include <QTest>
+
+#include "iconatlas.h"
+
+class IconAtlasTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void sharedPage();
+    void sameImageSameTexture();
+    void mergedSlots();
+
+private:
+    static QImage image(int width, int height, const QColor &color = Qt::red);
+    // The position of texture on its page, in pixels
+    static QPoint position(const std::shared_ptr<QSGTexture> &texture);
+
+    QQuickWindow m_window;
+};
+
+QImage IconAtlasTest::image(int width, int height, const QColor &color)
+{
+    QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+    image.fill(color);
+    return image;
+}
+
+QPoint IconAtlasTest::position(const std::shared_ptr<QSGTexture> &texture)
+{
+    const QRectF rect = texture->normalizedTextureSubRect();
+    const QSizeF pageSize(texture->textureSize().width() / rect.width(), texture->textureSize().height() / rect.height());
+    return QPoint(qRound(rect.x() * pageSize.width()), qRound(rect.y() * pageSize.height()));
+}
+
+void IconAtlasTest::sharedPage()
+{
+    const QImage small = image(16, 16);
+    const QImage other = image(16, 16, Qt::blue);
+    const QImage large = image(48, 48);
+
+    const auto smallTexture = IconAtlas::loadTexture(&m_window, small);
+    const auto otherTexture = IconAtlas::loadTexture(&m_window, other);
+    const auto largeTexture = IconAtlas::loadTexture(&m_window, large);
+
+    // One texture for all, so the renderer can batch their nodes
+    QVERIFY(smallTexture->isAtlasTexture());
+    QCOMPARE(otherTexture->comparisonKey(), smallTexture->comparisonKey());
+    QCOMPARE(largeTexture->comparisonKey(), smallTexture->comparisonKey());
+
+    QCOMPARE(smallTexture->textureSize(), QSize(16, 16));
+    QCOMPARE(largeTexture->textureSize(), QSize(48, 48));
+    QVERIFY(!smallTexture->normalizedTextureSubRect().intersects(otherTexture->normalizedTextureSubRect()));
+    QVERIFY(!smallTexture->normalizedTextureSubRect().intersects(largeTexture->normalizedTextureSubRect()));
+}
+
+void IconAtlasTest::sameImageSameTexture()
+{
+    const QImage small = image(16, 16);
+    const auto texture = IconAtlas::loadTexture(&m_window, small);
+    QCOMPARE(IconAtlas::loadTexture(&m_window, small), texture);
+    QVERIFY(IconAtlas::loadTexture(&m_window, image(16, 16)) != texture);
+}
+
+void IconAtlasTest::mergedSlots()
+{
+    const QImage first = image(16, 16);
+    const QImage second = image(16, 16);
+    const QImage third = image(16, 16);
+
+    auto firstTexture = IconAtlas::loadTexture(&m_window, first);
+    auto secondTexture = IconAtlas::loadTexture(&m_window, second);
+    const auto thirdTexture = IconAtlas::loadTexture(&m_window, third);
+    QCOMPARE(position(firstTexture), QPoint(1, 1));
+    QCOMPARE(position(secondTexture), QPoint(19, 1));
+    QCOMPARE(position(thirdTexture), QPoint(37, 1));
+
+    // Both slots together fit an image of twice the width on the same shelf
+    firstTexture.reset();
+    secondTexture.reset();
+    const QImage wide = image(34, 16);
+    const auto wideTexture = IconAtlas::loadTexture(&m_window, wide);
+    QCOMPARE(position(wideTexture), QPoint(1, 1));
+}
+
+QTEST_MAIN(IconAtlasTest)
+
+#include "iconatlastest.moc"
@@ -0,0 +1,169 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include <QGuiApplication>
+#include <QIconEngine>
+#include <QPainter>
+#include <QPalette>
+#include <QTest>
+
+#include "iconimagecache.h"
+
+// Stands in for the engine of QIcon::fromTheme(), which needs an icon theme
+class NamedIconEngine : public QIconEngine
+{
+public:
+    explicit NamedIconEngine(const QString &name)
+        : m_name(name)
+    {
+    }
+
+    void paint(QPainter *painter, const QRect &rect, QIcon::Mode mode, QIcon::State state) override
+    {
+        Q_UNUSED(mode);
+        Q_UNUSED(state);
+        painter->fillRect(rect, Qt::red);
+    }
+
+    QIconEngine *clone() const override
+    {
+        return new NamedIconEngine(m_name);
+    }
+
+    QString iconName() override
+    {
+        return m_name;
+    }
+
+private:
+    QString m_name;
+};
+
+class IconImageCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+
+    void namedIconKeys();
+    void themedIconKeys();
+    void unnamedIconKeys();
+    void statistics();
+    void maxBytes();
+
+private:
+    static QIcon namedIcon(const QString &name);
+    static QImage image(int size);
+};
+
+QIcon IconImageCacheTest::namedIcon(const QString &name)
+{
+    return QIcon(new NamedIconEngine(name));
+}
+
+QImage IconImageCacheTest::image(int size)
+{
+    QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::red);
+    return image;
+}
+
+void IconImageCacheTest::init()
+{
+    IconImageCache::setMaxBytes(16 * 1024 * 1024);
+    IconImageCache::clear();
+}
+
+void IconImageCacheTest::namedIconKeys()
+{
+    const QSize size(16, 16);
+    const auto key = IconImageCache::keyForIcon(namedIcon(QStringLiteral("go-next")), false, size, 1.0, QIcon::Normal);
+
+    // Separate icons of the same name render the same
+    QCOMPARE(IconImageCache::keyForIcon(namedIcon(QStringLiteral("go-next")), false, size, 1.0, QIcon::Normal), key);
+    QVERIFY(IconImageCache::keyForIcon(namedIcon(QStringLiteral("go-previous")), false, size, 1.0, QIcon::Normal) != key);
+    QVERIFY(IconImageCache::keyForIcon(namedIcon(QStringLiteral("go-next")), false, size * 2, 1.0, QIcon::Normal) != key);
+    QVERIFY(IconImageCache::keyForIcon(namedIcon(QStringLiteral("go-next")), false, size, 2.0, QIcon::Normal) != key);
+    QVERIFY(IconImageCache::keyForIcon(namedIcon(QStringLiteral("go-next")), false, size, 1.0, QIcon::Disabled) != key);
+
+    // Unless they are recolored differently
+    QIcon mask = namedIcon(QStringLiteral("go-next"));
+    mask.setIsMask(true);
+    QVERIFY(IconImageCache::keyForIcon(mask, false, size, 1.0, QIcon::Normal) != key);
+
+    const QPalette palette = QGuiApplication::palette();
+    QPalette otherPalette = palette;
+    otherPalette.setColor(QPalette::WindowText, Qt::green);
+    QGuiApplication::setPalette(otherPalette);
+    QVERIFY(IconImageCache::keyForIcon(namedIcon(QStringLiteral("go-next")), false, size, 1.0, QIcon::Normal) != key);
+    QGuiApplication::setPalette(palette);
+}
+
+void IconImageCacheTest::themedIconKeys()
+{
+    // Icons from the platform theme are shared as QIcon already
+    const QIcon icon = namedIcon(QStringLiteral("go-next"));
+    const auto key = IconImageCache::keyForIcon(icon, true, QSize(16, 16), 1.0, QIcon::Normal);
+    QCOMPARE(IconImageCache::keyForIcon(icon, true, QSize(16, 16), 1.0, QIcon::Normal), key);
+    QVERIFY(IconImageCache::keyForIcon(namedIcon(QStringLiteral("go-next")), true, QSize(16, 16), 1.0, QIcon::Normal) != key);
+}
+
+void IconImageCacheTest::unnamedIconKeys()
+{
+    const QIcon icon(QPixmap::fromImage(image(16)));
+    const auto key = IconImageCache::keyForIcon(icon, false, QSize(16, 16), 1.0, QIcon::Normal);
+    QCOMPARE(IconImageCache::keyForIcon(icon, false, QSize(16, 16), 1.0, QIcon::Normal), key);
+    QVERIFY(IconImageCache::keyForIcon(QIcon(QPixmap::fromImage(image(16))), false, QSize(16, 16), 1.0, QIcon::Normal) != key);
+}
+
+void IconImageCacheTest::statistics()
+{
+    const auto key = IconImageCache::keyForIcon(namedIcon(QStringLiteral("go-next")), false, QSize(32, 32), 1.0, QIcon::Normal);
+
+    QVERIFY(!IconImageCache::find(key));
+    IconImageCache::insert(key, image(32));
+    QVERIFY(IconImageCache::find(key));
+
+    auto statistics = IconImageCache::statistics();
+    QCOMPARE(statistics.hits, 1);
+    QCOMPARE(statistics.misses, 1);
+    QCOMPARE(statistics.entries, 1);
+    QCOMPARE(statistics.bytes, 4 * 1024);
+
+    // Failed loads are not cached
+    IconImageCache::insert(IconImageCache::Key{QStringLiteral("missing")}, QImage());
+    QCOMPARE(IconImageCache::statistics().entries, 1);
+
+    IconImageCache::clear();
+    statistics = IconImageCache::statistics();
+    QCOMPARE(statistics.hits, 0);
+    QCOMPARE(statistics.misses, 0);
+    QCOMPARE(statistics.entries, 0);
+}
+
+void IconImageCacheTest::maxBytes()
+{
+    // Room for one 32x32 image
+    IconImageCache::setMaxBytes(6 * 1024);
+    QCOMPARE(IconImageCache::statistics().maxBytes, 6 * 1024);
+
+    const IconImageCache::Key first{QStringLiteral("first")};
+    const IconImageCache::Key second{QStringLiteral("second")};
+    IconImageCache::insert(first, image(32));
+    IconImageCache::insert(second, image(32));
+    QVERIFY(!IconImageCache::find(first));
+    QVERIFY(IconImageCache::find(second));
+
+    // Nothing fits
+    IconImageCache::setMaxBytes(0);
+    IconImageCache::insert(first, image(32));
+    QVERIFY(!IconImageCache::find(first));
+}
+
+QTEST_MAIN(IconImageCacheTest)
+
+#include "iconimagecachetest.moc"
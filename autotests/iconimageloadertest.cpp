@@ -0,0 +1,146 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include <QNetworkAccessManager>
+#include <QSemaphore>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <atomic>
+
+#include "iconimageloader.h"
+
+// Counts the requests actually sent
+class CountingManager : public QNetworkAccessManager
+{
+public:
+    int requests = 0;
+
+protected:
+    QNetworkReply *createRequest(Operation operation, const QNetworkRequest &request, QIODevice *outgoingData) override
+    {
+        ++requests;
+        return QNetworkAccessManager::createRequest(operation, request, outgoingData);
+    }
+};
+
+class IconImageLoaderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void loadShared();
+    void remoteDownloadedOnce();
+    void remoteFailure();
+    void remoteManagerDeleted();
+
+private:
+    static IconImageCache::Key remoteKey(const QUrl &url, int size);
+
+    QTemporaryDir m_dir;
+    QUrl m_imageUrl;
+};
+
+IconImageCache::Key IconImageLoaderTest::remoteKey(const QUrl &url, int size)
+{
+    return IconImageCache::Key{url.toString(), 0, QSize(size, size), 1.0, QIcon::Normal};
+}
+
+void IconImageLoaderTest::initTestCase()
+{
+    // Only the opt-in disk cache would skip the network
+    QVERIFY(!qEnvironmentVariableIsSet("KIRIGAMI_ICON_DISK_CACHE_SIZE"));
+
+    QVERIFY(m_dir.isValid());
+    QImage image(64, 64, QImage::Format_ARGB32);
+    image.fill(Qt::red);
+    const QString path = m_dir.filePath(QStringLiteral("icon.png"));
+    QVERIFY(image.save(path));
+    m_imageUrl = QUrl::fromLocalFile(path);
+}
+
+void IconImageLoaderTest::init()
+{
+    IconImageCache::clear();
+}
+
+void IconImageLoaderTest::loadShared()
+{
+    const IconImageCache::Key key{QStringLiteral("shared"), 0, QSize(16, 16)};
+
+    std::atomic<int> decodes = 0;
+    QSemaphore started;
+    auto decode = [&decodes, &started]() {
+        started.acquire();
+        ++decodes;
+        QImage image(16, 16, QImage::Format_ARGB32);
+        image.fill(Qt::blue);
+        return image;
+    };
+
+    // The second request comes in while the first is still being decoded
+    auto first = IconImageLoader::load(key, decode);
+    auto second = IconImageLoader::load(key, decode);
+    started.release(2);
+
+    QTRY_VERIFY(first.isFinished() && second.isFinished());
+    QCOMPARE(decodes, 1);
+    QCOMPARE(second.result(), first.result());
+    QTRY_VERIFY(IconImageCache::find(key));
+}
+
+void IconImageLoaderTest::remoteDownloadedOnce()
+{
+    CountingManager manager;
+    auto small = IconImageLoader::loadRemote(&manager, m_imageUrl, remoteKey(m_imageUrl, 16));
+    auto large = IconImageLoader::loadRemote(&manager, m_imageUrl, remoteKey(m_imageUrl, 32));
+
+    QTRY_VERIFY(small.isFinished() && large.isFinished());
+    QCOMPARE(manager.requests, 1);
+    // Decoded for each requester
+    QCOMPARE(small.result().size(), QSize(16, 16));
+    QCOMPARE(large.result().size(), QSize(32, 32));
+    QTRY_VERIFY(IconImageCache::find(remoteKey(m_imageUrl, 16)));
+}
+
+void IconImageLoaderTest::remoteFailure()
+{
+    const QUrl url = QUrl::fromLocalFile(m_dir.filePath(QStringLiteral("missing.png")));
+    const auto key = remoteKey(url, 16);
+
+    CountingManager manager;
+    auto future = IconImageLoader::loadRemote(&manager, url, key);
+    QTRY_VERIFY(future.isFinished());
+
+    // A null image makes Icon show its fallback
+    QVERIFY(future.result().isNull());
+    QTest::qWait(10);
+    QVERIFY(!IconImageCache::find(key));
+
+    // Nothing is remembered about the failure, a later request tries again
+    auto retry = IconImageLoader::loadRemote(&manager, url, key);
+    QTRY_VERIFY(retry.isFinished());
+    QCOMPARE(manager.requests, 2);
+}
+
+void IconImageLoaderTest::remoteManagerDeleted()
+{
+    auto manager = new CountingManager;
+    auto future = IconImageLoader::loadRemote(manager, m_imageUrl, remoteKey(m_imageUrl, 16));
+
+    // Takes the reply with it before it finished
+    delete manager;
+
+    QTRY_VERIFY(future.isFinished());
+    QVERIFY(future.result().isNull());
+}
+
+QTEST_MAIN(IconImageLoaderTest)
+
+#include "iconimageloadertest.moc"
@@ -0,0 +1,251 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QScopeGuard>
+#include <QTest>
+
+#include <atomic>
+#include <cstddef>
+
+#include "config-OpenMP.h"
+#include "imagecolors.h"
+
+// Count heap allocations made while a palette is generated. Qt containers
+// allocate with malloc() and realloc() rather than operator new, so those
+// are what gets counted. Interposing them needs the glibc entry points.
+static std::atomic<quint64> s_allocations = 0;
+
+#if defined(__GLIBC__)
+#define KIRIGAMI_COUNT_ALLOCATIONS 1
+
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *ptr, std::size_t size);
+
+void *malloc(std::size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, std::size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+}
+#endif
+
+class ImageColorsBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void generatePalette_data();
+    void generatePalette();
+
+    void chroma();
+    void chromaRgb();
+    void colorToLab();
+    void luminance();
+
+private:
+    static QImage syntheticImage(const QString &kind, int size);
+};
+
+QImage ImageColorsBenchmark::syntheticImage(const QString &kind, int size)
+{
+    QImage image(size, size, QImage::Format_ARGB32);
+    QRandomGenerator random(42);
+
+    if (kind == QLatin1String("solid")) {
+        image.fill(QColor(200, 40, 40));
+    } else if (kind == QLatin1String("gradient")) {
+        QPainter painter(&image);
+        QLinearGradient gradient(0, 0, size, size);
+        gradient.setColorAt(0, Qt::red);
+        gradient.setColorAt(0.5, Qt::green);
+        gradient.setColorAt(1, Qt::blue);
+        painter.fillRect(image.rect(), gradient);
+    } else if (kind == QLatin1String("noise")) {
+        for (int y = 0; y < size; ++y) {
+            auto line = reinterpret_cast<QRgb *>(image.scanLine(y));
+            for (int x = 0; x < size; ++x) {
+                line[x] = random.generate() | 0xff000000;
+            }
+        }
+    } else if (kind == QLatin1String("blocks")) {
+        // Few distinct colors in large areas, like flat artwork
+        QPainter painter(&image);
+        const int block = std::max(1, size / 8);
+        for (int y = 0; y < size; y += block) {
+            for (int x = 0; x < size; x += block) {
+                painter.fillRect(x, y, block, block, QColor::fromHsv(random.bounded(6) * 60, 200, 220));
+            }
+        }
+    } else if (kind == QLatin1String("mostlyTransparent")) {
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        painter.setBrush(QColor(30, 120, 200));
+        painter.setPen(Qt::NoPen);
+        painter.drawEllipse(image.rect().adjusted(size / 3, size / 3, -size / 3, -size / 3));
+    } else if (kind == QLatin1String("grayscale")) {
+        for (int y = 0; y < size; ++y) {
+            auto line = reinterpret_cast<QRgb *>(image.scanLine(y));
+            for (int x = 0; x < size; ++x) {
+                const int gray = random.bounded(256);
+                line[x] = qRgb(gray, gray, gray);
+            }
+        }
+    }
+
+    return image;
+}
+
+void ImageColorsBenchmark::initTestCase()
+{
+    qInfo() << "Parallel backend:" << (HAVE_OpenMP ? "OpenMP" : "QThreadPool") << "max threads:" << ImageColors::maxThreads();
+#ifndef KIRIGAMI_COUNT_ALLOCATIONS
+    qInfo() << "Allocations are only counted with glibc";
+#endif
+}
+
+void ImageColorsBenchmark::generatePalette_data()
+{
+    QTest::addColumn<QImage>("image");
+    QTest::addColumn<ImageColors::Quantizer>("quantizer");
+    QTest::addColumn<int>("threads");
+
+    const QStringList kinds{
+        QStringLiteral("solid"),
+        QStringLiteral("gradient"),
+        QStringLiteral("noise"),
+        QStringLiteral("blocks"),
+        QStringLiteral("mostlyTransparent"),
+        QStringLiteral("grayscale"),
+    };
+    const QList<int> sizes{128, 512, 2048};
+    const QList<std::pair<const char *, ImageColors::Quantizer>> quantizers{
+        {"kmeans", ImageColors::KMeans},
+        {"histogram", ImageColors::Histogram},
+    };
+
+    // Single threaded and with the default thread cap
+    QList<int> threadCounts{1};
+    if (ImageColors::maxThreads() > 1) {
+        threadCounts.append(ImageColors::maxThreads());
+    }
+
+    for (const auto &[quantizerName, quantizer] : quantizers) {
+        for (int threads : threadCounts) {
+            for (const QString &kind : kinds) {
+                for (int size : sizes) {
+                    QTest::addRow("%s-%s-%d-t%d", quantizerName, qPrintable(kind), size, threads) << syntheticImage(kind, size) << quantizer << threads;
+                }
+            }
+            const QImage photo(QFINDTESTDATA("portrait-icon.png"));
+            QTest::addRow("%s-portrait-icon-t%d", quantizerName, threads) << photo << quantizer << threads;
+        }
+    }
+}
+
+void ImageColorsBenchmark::generatePalette()
+{
+    QFETCH(QImage, image);
+    QFETCH(ImageColors::Quantizer, quantizer);
+    QFETCH(int, threads);
+    QVERIFY(!image.isNull());
+
+    const int defaultThreads = ImageColors::maxThreads();
+    ImageColors::setMaxThreads(threads);
+    auto restoreThreads = qScopeGuard([defaultThreads]() {
+        ImageColors::setMaxThreads(defaultThreads);
+    });
+
+    qsizetype samples = 0;
+    quint64 runs = 0;
+    quint64 allocations = 0;
+    qint64 elapsed = 0;
+    QElapsedTimer timer;
+
+    // Timed inside the loop, so that the setup of QBENCHMARK is not counted
+    QBENCHMARK {
+        const quint64 allocationsBefore = s_allocations;
+        timer.start();
+        const ImageData imageData = ImageColors::generatePalette(image, quantizer);
+        elapsed += timer.nsecsElapsed();
+        allocations += s_allocations - allocationsBefore;
+        samples = imageData.m_samples.size();
+        ++runs;
+    }
+
+    runs = std::max<quint64>(1, runs);
+    auto info = qInfo().nospace();
+    info << QTest::currentDataTag() << ": " << samples << " samples, " //
+         << qRound64(qreal(samples) * runs * 1e9 / std::max<qint64>(1, elapsed)) << " samples/s";
+#ifdef KIRIGAMI_COUNT_ALLOCATIONS
+    info << ", " << allocations / runs << " allocations per run";
+#else
+    Q_UNUSED(allocations);
+#endif
+}
+
+void ImageColorsBenchmark::chroma()
+{
+    const QColor color(200, 120, 40);
+    qreal result = 0;
+    QBENCHMARK {
+        result += ColorUtils::chroma(color);
+    }
+    QVERIFY(result > 0);
+}
+
+void ImageColorsBenchmark::chromaRgb()
+{
+    const QRgb rgb = qRgb(200, 120, 40);
+    qreal result = 0;
+    QBENCHMARK {
+        result += ColorUtils::chromaRgb(rgb);
+    }
+    QVERIFY(result > 0);
+}
+
+void ImageColorsBenchmark::colorToLab()
+{
+    const QColor color(200, 120, 40);
+    qreal result = 0;
+    QBENCHMARK {
+        result += ColorUtils::colorToLab(color).l;
+    }
+    QVERIFY(result > 0);
+}
+
+void ImageColorsBenchmark::luminance()
+{
+    const QColor color(200, 120, 40);
+    qreal result = 0;
+    QBENCHMARK {
+        result += ColorUtils::luminance(color);
+    }
+    QVERIFY(result > 0);
+}
+
+QTEST_GUILESS_MAIN(ImageColorsBenchmark)
+
+#include "imagecolorsbenchmark.moc"
@@ -0,0 +1,304 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include <QDateTime>
+#include <QImage>
+#include <QRandomGenerator>
+#include <QScopeGuard>
+#include <QSignalSpy>
+#include <QTemporaryFile>
+#include <QTest>
+
+#include <cmath>
+
+#include "imagecolors.h"
+#include "imagecolorscache.h"
+
+class ImageColorsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+
+    void cacheKeys();
+    void cacheFileKeys();
+    void cacheStatistics();
+    void cacheMaxEntries();
+
+    void sharedBetweenInstances();
+    void explicitUpdateReapplies();
+    void cacheHitCancelsPendingUpdate();
+    void nullImageClearsPalette();
+
+    void samplesIndependentOfThreads();
+    void conversionTolerance();
+
+private:
+    static QImage solidImage(const QColor &color);
+    static QImage noiseImage(int size);
+    static ImageData paletteData(const QColor &dominant);
+};
+
+QImage ImageColorsTest::solidImage(const QColor &color)
+{
+    QImage image(32, 32, QImage::Format_ARGB32);
+    image.fill(color);
+    return image;
+}
+
+QImage ImageColorsTest::noiseImage(int size)
+{
+    QImage image(size, size, QImage::Format_ARGB32);
+    QRandomGenerator random(42);
+    for (int y = 0; y < size; ++y) {
+        auto line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < size; ++x) {
+            line[x] = random.generate() | 0xff000000;
+        }
+    }
+    return image;
+}
+
+ImageData ImageColorsTest::paletteData(const QColor &dominant)
+{
+    ImageData imageData;
+    imageData.m_samples = {dominant.rgb()};
+    imageData.m_palette = {PaletteSwatch(1.0, dominant, Qt::white)};
+    imageData.m_dominant = dominant;
+    imageData.m_average = dominant;
+    imageData.m_highlight = dominant;
+    return imageData;
+}
+
+void ImageColorsTest::init()
+{
+    ImageColorsCache::setMaxEntries(512);
+    ImageColorsCache::clear();
+}
+
+void ImageColorsTest::cacheKeys()
+{
+    const QImage red = solidImage(Qt::red);
+    const QImage otherRed = solidImage(Qt::red);
+    QVERIFY(red.cacheKey() != otherRed.cacheKey());
+
+    // Keyed by the pixels, not by the QImage instance
+    QCOMPARE(ImageColorsCache::keyForImage(red, ImageColors::KMeans), ImageColorsCache::keyForImage(otherRed, ImageColors::KMeans));
+    QVERIFY(ImageColorsCache::keyForImage(red, ImageColors::KMeans) != ImageColorsCache::keyForImage(solidImage(Qt::blue), ImageColors::KMeans));
+    QVERIFY(ImageColorsCache::keyForImage(red, ImageColors::KMeans) != ImageColorsCache::keyForImage(red, ImageColors::Histogram));
+
+    QVERIFY(ImageColorsCache::keyForImage(QImage(), ImageColors::KMeans).isEmpty());
+
+    // Large images are keyed by a sample of their pixels
+    const QImage large = noiseImage(1024);
+    QImage otherLarge = large.copy();
+    QCOMPARE(ImageColorsCache::keyForImage(large, ImageColors::KMeans), ImageColorsCache::keyForImage(otherLarge, ImageColors::KMeans));
+    otherLarge.setPixel(0, 0, 0xff000000);
+    QVERIFY(ImageColorsCache::keyForImage(large, ImageColors::KMeans) != ImageColorsCache::keyForImage(otherLarge, ImageColors::KMeans));
+    QVERIFY(ImageColorsCache::keyForImage(large, ImageColors::KMeans) != ImageColorsCache::keyForImage(noiseImage(1023), ImageColors::KMeans));
+}
+
+void ImageColorsTest::cacheFileKeys()
+{
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QVERIFY(solidImage(Qt::red).save(&file, "png"));
+    file.flush();
+
+    const QByteArray key = ImageColorsCache::keyForFile(file.fileName(), ImageColors::KMeans);
+    QVERIFY(!key.isEmpty());
+    QCOMPARE(ImageColorsCache::keyForFile(file.fileName(), ImageColors::KMeans), key);
+
+    // A modified file is a new image
+    QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(-60), QFileDevice::FileModificationTime));
+    QVERIFY(ImageColorsCache::keyForFile(file.fileName(), ImageColors::KMeans) != key);
+
+    QVERIFY(ImageColorsCache::keyForFile(file.fileName() + QStringLiteral(".missing"), ImageColors::KMeans).isEmpty());
+}
+
+void ImageColorsTest::cacheStatistics()
+{
+    const QByteArray key = ImageColorsCache::keyForImage(solidImage(Qt::red), ImageColors::KMeans);
+
+    QVERIFY(!ImageColorsCache::find(key));
+    QCOMPARE(ImageColorsCache::statistics().misses, 1);
+    QCOMPARE(ImageColorsCache::statistics().hits, 0);
+
+    ImageColorsCache::insert(key, paletteData(Qt::red));
+    QCOMPARE(ImageColorsCache::statistics().entries, 1);
+
+    const auto imageData = ImageColorsCache::find(key);
+    QVERIFY(imageData);
+    QCOMPARE(imageData->m_dominant, QColor(Qt::red));
+    // Raw samples are not kept
+    QVERIFY(imageData->m_samples.isEmpty());
+    QCOMPARE(ImageColorsCache::statistics().hits, 1);
+    QCOMPARE(ImageColorsCache::statistics().misses, 1);
+
+    // Empty keys are never looked up
+    QVERIFY(!ImageColorsCache::find(QByteArray()));
+    ImageColorsCache::insert(QByteArray(), paletteData(Qt::blue));
+    QCOMPARE(ImageColorsCache::statistics().misses, 1);
+    QCOMPARE(ImageColorsCache::statistics().entries, 1);
+
+    ImageColorsCache::clear();
+    const auto statistics = ImageColorsCache::statistics();
+    QCOMPARE(statistics.entries, 0);
+    QCOMPARE(statistics.hits, 0);
+    QCOMPARE(statistics.misses, 0);
+}
+
+void ImageColorsTest::cacheMaxEntries()
+{
+    ImageColorsCache::setMaxEntries(1);
+    QCOMPARE(ImageColorsCache::statistics().maxEntries, 1);
+
+    ImageColorsCache::insert("first", paletteData(Qt::red));
+    ImageColorsCache::insert("second", paletteData(Qt::blue));
+    QVERIFY(!ImageColorsCache::find("first"));
+    QVERIFY(ImageColorsCache::find("second"));
+
+    ImageColorsCache::setMaxEntries(0);
+    ImageColorsCache::insert("third", paletteData(Qt::green));
+    QVERIFY(!ImageColorsCache::find("third"));
+}
+
+void ImageColorsTest::sharedBetweenInstances()
+{
+    ImageColors first;
+    QSignalSpy firstSpy(&first, &ImageColors::paletteChanged);
+    first.setSource(solidImage(Qt::red));
+    QVERIFY(firstSpy.wait(10000));
+    QCOMPARE(ImageColorsCache::statistics().misses, 1);
+    QCOMPARE(ImageColorsCache::statistics().entries, 1);
+
+    // Same pixels in another image: served from the cache
+    ImageColors second;
+    QSignalSpy secondSpy(&second, &ImageColors::paletteChanged);
+    second.setSource(solidImage(Qt::red));
+    QVERIFY(secondSpy.wait(10000));
+    QCOMPARE(ImageColorsCache::statistics().hits, 1);
+    QCOMPARE(ImageColorsCache::statistics().misses, 1);
+    QCOMPARE(second.dominant(), first.dominant());
+}
+
+void ImageColorsTest::explicitUpdateReapplies()
+{
+    ImageColors imageColors;
+    QSignalSpy spy(&imageColors, &ImageColors::paletteChanged);
+    imageColors.setSource(solidImage(Qt::red));
+    QVERIFY(spy.wait(10000));
+    spy.clear();
+
+    // Setting the same pixels again is not a change
+    imageColors.setSource(solidImage(Qt::red));
+    QVERIFY(!spy.wait(200));
+
+    // An explicit update always emits, e.g. to follow theme changes
+    imageColors.update();
+    imageColors.update();
+    QVERIFY(spy.wait(10000));
+    QVERIFY(!spy.wait(200));
+    QCOMPARE(spy.count(), 1);
+}
+
+void ImageColorsTest::cacheHitCancelsPendingUpdate()
+{
+    QTemporaryFile file(QStringLiteral("XXXXXX.png"));
+    QVERIFY(file.open());
+    QVERIFY(solidImage(Qt::blue).save(&file, "png"));
+    file.flush();
+    ImageColorsCache::insert(ImageColorsCache::keyForFile(file.fileName(), ImageColors::KMeans), paletteData(Qt::blue));
+
+    ImageColors imageColors;
+    QSignalSpy spy(&imageColors, &ImageColors::paletteChanged);
+    imageColors.setSource(solidImage(Qt::red));
+    // Applied right away from the cache
+    imageColors.setSource(QUrl::fromLocalFile(file.fileName()).toString());
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(imageColors.dominant(), QColor(Qt::blue));
+
+    // The update queued for the red image must not override it
+    QVERIFY(!spy.wait(500));
+    QCOMPARE(imageColors.dominant(), QColor(Qt::blue));
+}
+
+void ImageColorsTest::nullImageClearsPalette()
+{
+    ImageColors imageColors;
+    QSignalSpy spy(&imageColors, &ImageColors::paletteChanged);
+    imageColors.setSource(solidImage(Qt::red));
+    QVERIFY(spy.wait(10000));
+    QVERIFY(!imageColors.palette().isEmpty());
+
+    imageColors.setSource(QImage());
+    QVERIFY(spy.wait(10000));
+    QVERIFY(imageColors.palette().isEmpty());
+}
+
+void ImageColorsTest::samplesIndependentOfThreads()
+{
+    const int defaultThreads = ImageColors::maxThreads();
+    auto restoreThreads = qScopeGuard([defaultThreads]() {
+        ImageColors::setMaxThreads(defaultThreads);
+    });
+
+    // Large enough for the clustering to be split as well
+    const QImage image = noiseImage(512);
+
+    ImageColors::setMaxThreads(1);
+    const ImageData serial = ImageColors::generatePalette(image);
+    ImageColors::setMaxThreads(4);
+    const ImageData parallel = ImageColors::generatePalette(image);
+
+    QCOMPARE(parallel.m_samples, serial.m_samples);
+    QCOMPARE(parallel.m_average, serial.m_average);
+}
+
+void ImageColorsTest::conversionTolerance()
+{
+    // The textbook formulas, without lookup tables or approximations
+    auto exactLab = [](QRgb rgb) {
+        auto linear = [](int channel) {
+            const qreal v = channel / 255.0;
+            return v > 0.04045 ? std::pow((v + 0.055) / 1.055, 2.4) : v / 12.92;
+        };
+        auto pivot = [](qreal v) {
+            return v > 0.008856 ? std::cbrt(v) : (7.787 * v) + (16.0 / 116.0);
+        };
+        const qreal r = linear(qRed(rgb));
+        const qreal g = linear(qGreen(rgb));
+        const qreal b = linear(qBlue(rgb));
+        const qreal x = pivot((r * 0.4124 + g * 0.3576 + b * 0.1805) / 0.95047);
+        const qreal y = pivot(r * 0.2126 + g * 0.7152 + b * 0.0722);
+        const qreal z = pivot((r * 0.0193 + g * 0.1192 + b * 0.9505) / 1.08883);
+        return ColorUtils::LabColor{std::max(0.0, (116 * y) - 16), 500 * (x - y), 200 * (y - z)};
+    };
+
+    constexpr qreal tolerance = 1e-9;
+    for (int r = 0; r < 256; r += 5) {
+        for (int g = 0; g < 256; g += 5) {
+            for (int b = 0; b < 256; b += 5) {
+                const QRgb rgb = qRgb(r, g, b);
+                const auto expected = exactLab(rgb);
+                const auto lab = ColorUtils::rgbToLab(rgb);
+                QVERIFY(std::abs(lab.l - expected.l) < tolerance);
+                QVERIFY(std::abs(lab.a - expected.a) < tolerance);
+                QVERIFY(std::abs(lab.b - expected.b) < tolerance);
+                QCOMPARE(ColorUtils::chroma(QColor(rgb)), ColorUtils::chromaRgb(rgb));
+            }
+        }
+    }
+
+    // Global colors must not be taken for QRgb values
+    QVERIFY(std::abs(ColorUtils::luminance(Qt::white) - 1.0) < 1e-3);
+    QCOMPARE(ColorUtils::chroma(Qt::red), ColorUtils::chroma(QColor(Qt::red)));
+}
+
+QTEST_MAIN(ImageColorsTest)
+
+#include "imagecolorstest.moc"
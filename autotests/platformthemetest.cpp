@@ -0,0 +1,269 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include <QQmlEngine>
+#include <QSignalSpy>
+#include <QTest>
+
+#include <memory>
+#include <vector>
+
+#include "platformtheme.h"
+
+using namespace Kirigami::Platform;
+
+// Exposes the setters used by theme implementations, and records the change
+// events the theme receives from its data.
+class TestTheme : public PlatformTheme
+{
+    Q_OBJECT
+
+public:
+    using PlatformTheme::PlatformTheme;
+    using PlatformTheme::setBackgroundColor;
+    using PlatformTheme::setDefaultFont;
+    using PlatformTheme::setSmallFont;
+    using PlatformTheme::setTextColor;
+
+    QList<std::pair<QColor, QColor>> colorEvents;
+    QList<std::pair<QFont, QFont>> fontEvents;
+    int iconLookups = 0;
+
+    QIcon iconFromTheme(const QString &name, const QColor &customColor) override
+    {
+        ++iconLookups;
+        return PlatformTheme::iconFromTheme(name, customColor);
+    }
+
+protected:
+    bool event(QEvent *event) override
+    {
+        if (event->type() == PlatformThemeEvents::ColorChangedEvent::type) {
+            auto changeEvent = static_cast<PlatformThemeEvents::ColorChangedEvent *>(event);
+            colorEvents.append({changeEvent->oldValue, changeEvent->newValue});
+        } else if (event->type() == PlatformThemeEvents::FontChangedEvent::type) {
+            auto changeEvent = static_cast<PlatformThemeEvents::FontChangedEvent *>(event);
+            fontEvents.append({changeEvent->oldValue, changeEvent->newValue});
+        }
+        return PlatformTheme::event(event);
+    }
+};
+
+class PlatformThemeTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void singleChanges();
+    void transactionColors();
+    void transactionFonts();
+    void transactionRevertedChange();
+
+    void sharedData();
+    void sharedDataPerEngine();
+    void sharedDataAfterColorGroupChange();
+
+    void cachedIcons();
+};
+
+void PlatformThemeTest::singleChanges()
+{
+    QObject owner;
+    TestTheme theme(&owner);
+    theme.setTextColor(Qt::black);
+    theme.colorEvents.clear();
+
+    QSignalSpy spy(&theme, &PlatformTheme::colorsChanged);
+    theme.setTextColor(Qt::red);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(theme.colorEvents.size(), 1);
+    QCOMPARE(theme.colorEvents[0].first, QColor(Qt::black));
+    QCOMPARE(theme.colorEvents[0].second, QColor(Qt::red));
+}
+
+void PlatformThemeTest::transactionColors()
+{
+    QObject owner;
+    TestTheme theme(&owner);
+    theme.setTextColor(Qt::black);
+    theme.setBackgroundColor(Qt::white);
+    theme.colorEvents.clear();
+
+    QSignalSpy spy(&theme, &PlatformTheme::colorsChanged);
+    {
+        PlatformThemeChangeTracker tracker(&theme);
+        theme.setTextColor(Qt::red);
+        theme.setBackgroundColor(Qt::blue);
+        theme.setTextColor(Qt::green);
+
+        // Applied right away, but only announced once tracking ends
+        QCOMPARE(theme.textColor(), QColor(Qt::green));
+        QVERIFY(theme.colorEvents.isEmpty());
+        QCOMPARE(spy.count(), 0);
+    }
+
+    QCOMPARE(spy.count(), 1);
+    // One event per changed color, from its value before the transaction
+    QCOMPARE(theme.colorEvents.size(), 2);
+    QVERIFY(theme.colorEvents.contains(std::pair(QColor(Qt::black), QColor(Qt::green))));
+    QVERIFY(theme.colorEvents.contains(std::pair(QColor(Qt::white), QColor(Qt::blue))));
+}
+
+void PlatformThemeTest::transactionFonts()
+{
+    QObject owner;
+    TestTheme theme(&owner);
+    const QFont defaultFont = theme.defaultFont();
+    const QFont smallFont = theme.smallFont();
+
+    QFont newDefaultFont = defaultFont;
+    newDefaultFont.setPointSizeF(defaultFont.pointSizeF() + 2);
+    QFont newSmallFont = smallFont;
+    newSmallFont.setItalic(!smallFont.italic());
+
+    {
+        PlatformThemeChangeTracker tracker(&theme);
+        theme.setDefaultFont(newDefaultFont);
+        theme.setSmallFont(newSmallFont);
+        QVERIFY(theme.fontEvents.isEmpty());
+    }
+
+    QCOMPARE(theme.fontEvents.size(), 2);
+    QVERIFY(theme.fontEvents.contains(std::pair(defaultFont, newDefaultFont)));
+    QVERIFY(theme.fontEvents.contains(std::pair(smallFont, newSmallFont)));
+}
+
+void PlatformThemeTest::transactionRevertedChange()
+{
+    QObject owner;
+    TestTheme theme(&owner);
+    theme.setTextColor(Qt::black);
+    theme.colorEvents.clear();
+
+    {
+        PlatformThemeChangeTracker tracker(&theme);
+        theme.setTextColor(Qt::red);
+        theme.setTextColor(Qt::black);
+    }
+
+    // Nothing to report for a color that ended up unchanged
+    QVERIFY(theme.colorEvents.isEmpty());
+}
+
+void PlatformThemeTest::sharedData()
+{
+    const int dataBlocks = PlatformTheme::dataBlockCount();
+
+    {
+        QObject firstOwner;
+        QObject secondOwner;
+        TestTheme first(&firstOwner);
+        auto second = std::make_unique<TestTheme>(&secondOwner);
+        QCOMPARE(PlatformTheme::dataBlockCount(), dataBlocks + 1);
+
+        // Changing shared data gives the theme a copy of its own
+        second->setTextColor(Qt::red);
+        QCOMPARE(PlatformTheme::dataBlockCount(), dataBlocks + 2);
+        QCOMPARE(second->textColor(), QColor(Qt::red));
+        QVERIFY(first.textColor() != QColor(Qt::red));
+
+        second.reset();
+        QCOMPARE(PlatformTheme::dataBlockCount(), dataBlocks + 1);
+    }
+    QCOMPARE(PlatformTheme::dataBlockCount(), dataBlocks);
+
+    // Data nobody uses anymore is not handed out again
+    QObject owner;
+    TestTheme theme(&owner);
+    QCOMPARE(PlatformTheme::dataBlockCount(), dataBlocks + 1);
+    QVERIFY(theme.textColor() != QColor(Qt::red));
+}
+
+void PlatformThemeTest::sharedDataPerEngine()
+{
+    const int dataBlocks = PlatformTheme::dataBlockCount();
+
+    QQmlEngine firstEngine;
+    QQmlEngine secondEngine;
+    QObject firstOwner;
+    QObject secondOwner;
+    QQmlEngine::setContextForObject(&firstOwner, firstEngine.rootContext());
+    QQmlEngine::setContextForObject(&secondOwner, secondEngine.rootContext());
+
+    TestTheme first(&firstOwner);
+    TestTheme second(&secondOwner);
+    QCOMPARE(PlatformTheme::dataBlockCount(), dataBlocks + 2);
+}
+
+void PlatformThemeTest::sharedDataAfterColorGroupChange()
+{
+    const int dataBlocks = PlatformTheme::dataBlockCount();
+
+    std::vector<std::unique_ptr<QObject>> owners;
+    std::vector<std::unique_ptr<TestTheme>> themes;
+    for (int i = 0; i < 5; ++i) {
+        owners.push_back(std::make_unique<QObject>());
+        themes.push_back(std::make_unique<TestTheme>(owners.back().get()));
+    }
+    QCOMPARE(PlatformTheme::dataBlockCount(), dataBlocks + 1);
+
+    // Like a window being deactivated and activated again: the themes move
+    // over to the shared data of the new colorGroup one after the other.
+    for (auto colorGroup : {PlatformTheme::Inactive, PlatformTheme::Active}) {
+        for (const auto &theme : themes) {
+            theme->setColorGroup(colorGroup);
+            QCOMPARE(theme->colorGroup(), colorGroup);
+        }
+        QCOMPARE(PlatformTheme::dataBlockCount(), dataBlocks + 1);
+    }
+
+    // Also when the values of the shared data change for all of them
+    for (const auto &theme : themes) {
+        theme->setTextColor(Qt::red);
+    }
+    QCOMPARE(PlatformTheme::dataBlockCount(), dataBlocks + 1);
+    QCOMPARE(themes.front()->textColor(), QColor(Qt::red));
+
+    // But not with local overrides
+    themes.front()->setCustomTextColor(Qt::blue);
+    QCOMPARE(PlatformTheme::dataBlockCount(), dataBlocks + 2);
+}
+
+void PlatformThemeTest::cachedIcons()
+{
+    const QString name = QStringLiteral("kirigami-platformthemetest-icon");
+
+    QObject firstOwner;
+    QObject secondOwner;
+    TestTheme first(&firstOwner);
+    TestTheme second(&secondOwner);
+
+    first.cachedIconFromTheme(name);
+    first.cachedIconFromTheme(name);
+    QCOMPARE(first.iconLookups, 1);
+
+    // Shared between themes with the same palette
+    second.cachedIconFromTheme(name);
+    QCOMPARE(second.iconLookups, 0);
+
+    first.cachedIconFromTheme(name, Qt::red);
+    QCOMPARE(first.iconLookups, 2);
+
+    // Other colors may recolor the icon differently
+    second.setTextColor(Qt::red);
+    second.cachedIconFromTheme(name);
+    QCOMPARE(second.iconLookups, 1);
+
+    // As may local overrides, which are not cached
+    first.setCustomTextColor(Qt::green);
+    first.cachedIconFromTheme(name);
+    first.cachedIconFromTheme(name);
+    QCOMPARE(first.iconLookups, 4);
+}
+
+QTEST_MAIN(PlatformThemeTest)
+
+#include "platformthemetest.moc"
@@ -100,6 +100,9 @@ TestCase {
         // Make sure the new color has actually been rendered before update() grabs
         // the item (grabToImage only completes after a render pass).
         verify(waitForRendering(testCase));
+        // The palette of the initial, transparent grab may already have been
+        // applied from the shared cache; only count what update() emits.
+        paletteChangedSpy.clear();
         imageColors.update();
         // Palette extraction then runs on a worker thread; give slow CI headroom.
         paletteChangedSpy.wait(10000);
@@ -113,6 +116,95 @@ TestCase {
         compare(imageColors.palette[0], item.swatch);
     }
 
+    function test_extractColorsHistogram(): void {
+        const item = createTemporaryObject(colorsComponent, testCase);
+        const { colorArea, imageColors, paletteChangedSpy } = item;
+
+        imageColors.quantizer = Kirigami.ImageColors.Histogram;
+        colorArea.color = Qt.rgba(1, 0, 0);
+        verify(waitForRendering(testCase));
+        paletteChangedSpy.clear();
+        imageColors.update();
+        paletteChangedSpy.wait(10000);
+        compare(paletteChangedSpy.count, 1);
+        compare(imageColors.dominant, colorArea.color);
+
+        compare(imageColors.palette.length, 1);
+        compare(imageColors.palette[0].ratio, 1.0);
+        compare(imageColors.palette[0].color, colorArea.color);
+        compare(imageColors.palette[0].contrastColor, "#e6e6e6");
+    }
+
+    Component {
+        id: spinnerComponent
+        // Keeps the window rendering new frames outside of the sampled item
+        Rectangle {
+            x: 300
+            width: 10
+            height: 10
+            color: "blue"
+            RotationAnimation on rotation {
+                from: 0
+                to: 360
+                loops: Animation.Infinite
+                duration: 1000
+            }
+        }
+    }
+
+    function test_unchangedGrab(): void {
+        const item = createTemporaryObject(colorsComponent, testCase);
+        const { colorArea, imageColors, paletteChangedSpy } = item;
+
+        colorArea.color = Qt.rgba(1, 0, 0);
+        verify(waitForRendering(testCase));
+        paletteChangedSpy.clear();
+        imageColors.update();
+        verify(paletteChangedSpy.wait(10000));
+        compare(imageColors.dominant, colorArea.color);
+        paletteChangedSpy.clear();
+
+        // New frames are rendered and grabbed, but the pixels of the source
+        // item stay the same: the palette is not emitted again.
+        createTemporaryObject(spinnerComponent, testCase);
+        imageColors.updateInterval = 1;
+        for (let i = 0; i < 10; ++i) {
+            verify(waitForRendering(testCase));
+        }
+        compare(paletteChangedSpy.count, 0);
+
+        // Until they do change
+        colorArea.color = Qt.rgba(0, 0, 1);
+        verify(paletteChangedSpy.wait(10000));
+        verify(!Qt.colorEqual(imageColors.dominant, Qt.rgba(1, 0, 0)));
+    }
+
+    function test_updateIntervalThrottles(): void {
+        const item = createTemporaryObject(colorsComponent, testCase);
+        const { colorArea, imageColors, paletteChangedSpy } = item;
+
+        colorArea.color = Qt.rgba(1, 0, 0);
+        verify(waitForRendering(testCase));
+        paletteChangedSpy.clear();
+        imageColors.update();
+        verify(paletteChangedSpy.wait(10000));
+        paletteChangedSpy.clear();
+
+        // Change the pixels on every frame: nothing is grabbed before the
+        // interval elapsed.
+        imageColors.updateInterval = 60 * 60 * 1000;
+        for (let i = 1; i <= 10; ++i) {
+            colorArea.color = Qt.hsla(i / 20, 1, 0.5, 1);
+            verify(waitForRendering(testCase));
+        }
+        compare(paletteChangedSpy.count, 0);
+
+        // Once it does, the latest content is picked up
+        imageColors.updateInterval = 1;
+        verify(paletteChangedSpy.wait(10000));
+        verify(!Qt.colorEqual(imageColors.dominant, Qt.rgba(1, 0, 0)));
+    }
+
     function test_invisibleWindow(): void {
         // Do not attempt to grabToImage on an item whose window is invisible.
         failOnWarning(/.?/);
@@ -42,6 +42,14 @@ TestCase {
             source: Qt.resolvedUrl("portrait-icon.png")
         }
     }
+    Component {
+        id: animatedIcon
+        Kirigami.Icon {
+            width: 50
+            height: 50
+            animated: true
+        }
+    }
     Kirigami.ImageColors {
         id: imageColors
     }
@@ -85,6 +93,30 @@ TestCase {
                "portrait icon must not be stretched wide: paintedWidth=" + icon.paintedWidth + " paintedHeight=" + icon.paintedHeight)
     }
 
+    // Image files decoded on a worker thread end up like synchronously loaded ones.
+    function test_asynchronous() {
+        let icon = createTemporaryObject(portraitIcon, testCase, { asynchronous: true })
+        verify(icon)
+        verify(waitForRendering(icon))
+        tryVerify(() => icon.status === Kirigami.Icon.Ready)
+        verify(icon.paintedWidth > 0 && icon.paintedWidth < icon.paintedHeight)
+
+        icon.source = Qt.resolvedUrl("does-not-exist.png")
+        tryVerify(() => icon.status === Kirigami.Icon.Error)
+    }
+
+    // The crossfade runs on the render thread, once it is done only the new
+    // image is shown.
+    function test_animated_source_change() {
+        let icon = createTemporaryObject(animatedIcon, testCase, { source: Qt.resolvedUrl("portrait-icon.png") })
+        let reference = createTemporaryObject(animatedIcon, testCase, { x: 100, animated: false, source: Qt.resolvedUrl("stop-icon.svg") })
+        verify(icon && reference)
+        verify(waitForRendering(icon))
+
+        icon.source = Qt.resolvedUrl("stop-icon.svg")
+        tryVerify(() => grabImage(icon).equals(grabImage(reference)), 5000, "The blend did not end on the new icon")
+    }
+
     function test_absolutepath_recoloring() {
         skip("This test depends too much on environment and other factors to work reliably")
 
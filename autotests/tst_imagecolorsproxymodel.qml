@@ -0,0 +1,102 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+import QtQuick
+import QtTest
+import org.kde.kirigami as Kirigami
+
+TestCase {
+    id: testCase
+    name: "ImageColorsProxyModelTest"
+
+    width: 400
+    height: 400
+    visible: true
+
+    when: windowShown
+
+    Component {
+        id: viewComponent
+        Item {
+            readonly property alias sourceModel: sourceModel
+            readonly property alias proxyModel: proxyModel
+            readonly property alias repeater: repeater
+
+            readonly property SignalSpy dataChangedSpy: SignalSpy {
+                target: proxyModel
+                signalName: "dataChanged"
+            }
+
+            ListModel {
+                id: sourceModel
+                ListElement {
+                    cover: ""
+                }
+                ListElement {
+                    cover: ""
+                }
+            }
+
+            Kirigami.ImageColorsProxyModel {
+                id: proxyModel
+                sourceModel: sourceModel
+                imageRole: "cover"
+            }
+
+            Repeater {
+                id: repeater
+                model: proxyModel
+                delegate: Item {
+                    required property var cover
+                    required property var dominant
+                    required property var palette
+                }
+            }
+        }
+    }
+
+    function test_palettes(): void {
+        const view = createTemporaryObject(viewComponent, testCase);
+        const { sourceModel, repeater, dataChangedSpy } = view;
+        compare(repeater.count, 2);
+        compare(repeater.itemAt(0).dominant, undefined);
+
+        const url = Qt.resolvedUrl("portrait-icon.png").toString();
+        sourceModel.setProperty(0, "cover", url);
+        sourceModel.setProperty(1, "cover", url);
+
+        tryVerify(() => repeater.itemAt(0).dominant !== undefined, 10000);
+        tryVerify(() => repeater.itemAt(1).dominant !== undefined, 10000);
+        verify(repeater.itemAt(0).palette.length > 0);
+        compare(repeater.itemAt(0).dominant, repeater.itemAt(1).dominant);
+    }
+
+    function test_imageChanges(): void {
+        const view = createTemporaryObject(viewComponent, testCase);
+        const { sourceModel, repeater } = view;
+
+        const url = Qt.resolvedUrl("portrait-icon.png").toString();
+        sourceModel.setProperty(0, "cover", url);
+        sourceModel.setProperty(1, "cover", url);
+        tryVerify(() => repeater.itemAt(0).dominant !== undefined, 10000);
+        tryVerify(() => repeater.itemAt(1).dominant !== undefined, 10000);
+
+        // The row forgets the palette of its previous image
+        sourceModel.setProperty(0, "cover", "");
+        compare(repeater.itemAt(0).dominant, undefined);
+        verify(repeater.itemAt(1).dominant !== undefined);
+
+        // Remaining rows keep theirs after others are removed
+        const dominant = repeater.itemAt(1).dominant;
+        sourceModel.remove(0);
+        compare(repeater.count, 1);
+        compare(repeater.itemAt(0).dominant, dominant);
+
+        sourceModel.insert(0, { cover: "" });
+        compare(repeater.itemAt(0).dominant, undefined);
+        compare(repeater.itemAt(1).dominant, dominant);
+    }
+}
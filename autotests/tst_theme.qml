@@ -218,6 +218,146 @@ TestCase {
         compare(item.child3.color, "#31363b")
     }
 
+    Component {
+        id: propagation
+
+        Rectangle {
+            Kirigami.Theme.inherit: false
+
+            color: Kirigami.Theme.backgroundColor
+
+            property alias child1: rect1
+            property alias child2: rect2
+            property alias child3: rect3
+            property alias child4: rect4
+
+            readonly property SignalSpy child2Spy: SignalSpy {
+                target: rect2.Kirigami.Theme
+                signalName: "colorsChanged"
+            }
+            readonly property SignalSpy child3Spy: SignalSpy {
+                target: rect3.Kirigami.Theme
+                signalName: "colorsChanged"
+            }
+            readonly property SignalSpy child4Spy: SignalSpy {
+                target: rect4.Kirigami.Theme
+                signalName: "colorsChanged"
+            }
+
+            Rectangle {
+                id: rect1
+                Kirigami.Theme.inherit: false
+                Kirigami.Theme.colorSet: Kirigami.Theme.Complementary
+                color: Kirigami.Theme.backgroundColor
+
+                Rectangle {
+                    id: rect2
+                    color: Kirigami.Theme.backgroundColor
+
+                    Rectangle {
+                        id: rect3
+                        color: Kirigami.Theme.backgroundColor
+                    }
+                    Rectangle {
+                        id: rect4
+                        color: Kirigami.Theme.backgroundColor
+                    }
+                }
+            }
+        }
+    }
+
+    function test_propagation_coalesced() {
+        var item = createTemporaryObject(propagation, testCase)
+        verify(item)
+
+        compare(item.child3.color, "#31363b")
+        compare(item.child4.color, "#31363b")
+        item.child2Spy.clear()
+        item.child3Spy.clear()
+        item.child4Spy.clear()
+
+        // Every theme below the change moves to the new data, which schedules
+        // its own children in turn: each of them is updated exactly once.
+        item.child1.Kirigami.Theme.inherit = true
+
+        // Propagation is not deferred, inherited colors are up to date right away
+        compare(item.child1.color, "#eff0f1")
+        compare(item.child2.color, "#eff0f1")
+        compare(item.child3.color, "#eff0f1")
+        compare(item.child4.color, "#eff0f1")
+        compare(item.child2Spy.count, 1)
+        compare(item.child3Spy.count, 1)
+        compare(item.child4Spy.count, 1)
+
+        // Each further change is propagated on its own
+        item.child1.Kirigami.Theme.inherit = false
+
+        compare(item.child3.color, "#31363b")
+        compare(item.child3Spy.count, 2)
+        compare(item.child4Spy.count, 2)
+    }
+
+    Component {
+        id: reparent
+
+        Rectangle {
+            Kirigami.Theme.inherit: false
+
+            color: Kirigami.Theme.backgroundColor
+
+            property alias first: first
+            property alias second: second
+            property alias moved: moved
+            property alias leaf: leaf
+
+            Rectangle {
+                id: first
+                Kirigami.Theme.inherit: false
+                Kirigami.Theme.colorSet: Kirigami.Theme.Complementary
+                color: Kirigami.Theme.backgroundColor
+
+                // Neither of these has a theme of its own
+                Item {
+                    id: moved
+
+                    Item {
+                        Rectangle {
+                            id: leaf
+                            color: Kirigami.Theme.backgroundColor
+                        }
+                    }
+                }
+            }
+
+            Rectangle {
+                id: second
+                Kirigami.Theme.inherit: false
+                Kirigami.Theme.colorSet: Kirigami.Theme.View
+                color: Kirigami.Theme.backgroundColor
+            }
+        }
+    }
+
+    function test_reparent_unthemed_ancestor() {
+        var item = createTemporaryObject(reparent, testCase)
+        verify(item)
+
+        compare(item.leaf.color, "#31363b")
+
+        // Only an item above the themed one moves, within the same window
+        item.moved.parent = item.second
+        compare(item.leaf.color, "#fcfcfc")
+
+        // Changes of the new parent theme are propagated to it
+        item.second.Kirigami.Theme.inherit = true
+        compare(item.second.color, "#eff0f1")
+        compare(item.leaf.color, "#eff0f1")
+
+        item.second.Kirigami.Theme.inherit = false
+        compare(item.leaf.color, "#fcfcfc")
+    }
+
     Component {
         id: colorSet
 
@@ -375,4 +515,16 @@ TestCase {
         compare(item.child1.color, "#2b2d2f")
         compare(item.child2.color, "#2b2d2f")
     }
+
+    function test_statistics() {
+        var item = createTemporaryObject(basic, testCase)
+        verify(item)
+
+        Kirigami.ThemeStatistics.refresh()
+        verify(Kirigami.ThemeStatistics.themeCount >= 2)
+        verify(Kirigami.ThemeStatistics.dataBlockCount >= 1)
+        verify(Kirigami.ThemeStatistics.dataBlockCount <= Kirigami.ThemeStatistics.themeCount)
+        verify(Kirigami.ThemeStatistics.sharingRatio >= 1)
+        compare(Kirigami.ThemeStatistics.propagationHistogram.length, Kirigami.ThemeStatistics.propagationBucketLimits.length + 1)
+    }
 }
@@ -15,6 +15,7 @@
 #include <QQmlContext>
 #include <QQuickItem>
 
+#include "platform/basictheme_p.h"
 #include "platform/styleselector.h"
 
 #ifdef KIRIGAMI_BUILD_TYPE_STATIC
@@ -134,6 +135,10 @@ void KirigamiControlsPlugin::initializeEngine(QQmlEngine *engine, const char *ur
 {
     Q_UNUSED(uri);
     connect(this, &KirigamiControlsPlugin::languageChangeEvent, engine, &QQmlEngine::retranslate);
+
+    // Compile the style's theme definition while the application loads its
+    // own QML, rather than when the first item asks for its theme.
+    Kirigami::Platform::BasicTheme::preloadDefinition(engine);
 }
 
 #ifdef KIRIGAMI_BUILD_TYPE_STATIC
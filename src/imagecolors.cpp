@@ -8,28 +8,48 @@
 #include "imagecolors.h"
 
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFutureWatcher>
+#include <QSemaphore>
 #include <QGuiApplication>
+#include <QImageReader>
+#include <QtAlgorithms>
+#include <QThread>
+#include <QThreadPool>
 #include <QtConcurrentRun>
+#include <QtConcurrentTask>
 
+#include "imagecolorscache.h"
 #include "loggingcategory.h"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <limits>
+#include <utility>
 #include <vector>
 
 #include "config-OpenMP.h"
-#if HAVE_OpenMP
-#include <omp.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define KIRIGAMI_IMAGECOLORS_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define KIRIGAMI_IMAGECOLORS_NEON 1
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
 #endif
 
 #include "platform/platformtheme.h"
 
 #define return_fallback(value)                                                                                                                                 \
-    if (m_imageData.m_samples.size() == 0) {                                                                                                                   \
+    if (m_imageData.m_palette.isEmpty()) {                                                                                                                     \
         return value;                                                                                                                                          \
     }
 
 #define return_fallback_finally(value, finally)                                                                                                                \
-    if (m_imageData.m_samples.size() == 0) {                                                                                                                   \
+    if (m_imageData.m_palette.isEmpty()) {                                                                                                                     \
         return value.isValid()                                                                                                                                 \
             ? value                                                                                                                                            \
             : static_cast<Kirigami::Platform::PlatformTheme *>(qmlAttachedPropertiesObject<Kirigami::Platform::PlatformTheme>(this, true))->finally();         \
@@ -80,6 +100,7 @@ ImageColors::~ImageColors()
 void ImageColors::setSource(const QVariant &source)
 {
     if (m_futureSourceImageData) {
+        m_futureSourceImageData->disconnect(this, nullptr);
         m_futureSourceImageData->cancel();
         m_futureSourceImageData->deleteLater();
         m_futureSourceImageData = nullptr;
@@ -90,29 +111,29 @@ void ImageColors::setSource(const QVariant &source)
     } else if (source.canConvert<QImage>()) {
         setSourceImage(source.value<QImage>());
     } else if (source.canConvert<QIcon>()) {
-        setSourceImage(source.value<QIcon>().pixmap(128, 128).toImage());
+        setSourceImage(source.value<QIcon>().pixmap(s_sourceSize, s_sourceSize).toImage());
     } else if (source.canConvert<QString>()) {
         const QString sourceString = source.toString();
 
         if (QIcon::hasThemeIcon(sourceString)) {
-            setSourceImage(QIcon::fromTheme(sourceString).pixmap(128, 128).toImage());
+            setSourceImage(QIcon::fromTheme(sourceString).pixmap(s_sourceSize, s_sourceSize).toImage());
         } else {
-            QFuture<QImage> future = QtConcurrent::run([sourceString]() {
-                if (auto url = QUrl(sourceString); url.isLocalFile()) {
-                    return QImage(url.toLocalFile());
-                }
-                return QImage(sourceString);
-            });
-            m_futureSourceImageData = new QFutureWatcher<QImage>(this);
-            connect(m_futureSourceImageData, &QFutureWatcher<QImage>::finished, this, [this, source]() {
-                const QImage image = m_futureSourceImageData->future().result();
-                m_futureSourceImageData->deleteLater();
-                m_futureSourceImageData = nullptr;
-                setSourceImage(image);
+            const QUrl url(sourceString);
+            const QString path = url.isLocalFile() ? url.toLocalFile() : sourceString;
+            const QByteArray cacheKey = ImageColorsCache::keyForFile(path, m_quantizer);
+            if (const auto imageData = ImageColorsCache::find(cacheKey)) {
+                // Drop the work queued for the previous source, so that it
+                // cannot override the cached palette once it finishes.
+                cancelUpdate();
+                clearSourceItem();
+                m_sourceFile = path;
+                m_sourceImage = QImage();
+                applyImageData(*imageData, cacheKey);
                 m_source = source;
                 Q_EMIT sourceChanged();
-            });
-            m_futureSourceImageData->setFuture(future);
+                return;
+            }
+            loadSourceFile(path, source);
             return;
         }
     } else {
@@ -128,7 +149,228 @@ QVariant ImageColors::source() const
     return m_source;
 }
 
-void ImageColors::setSourceImage(const QImage &image)
+// ImageColors jobs get their own bounded pool, so that a flick through a
+// long list cannot queue up enough of them to starve other users of the
+// global pool. Jobs of visible items are started first.
+QThreadPool *ImageColors::threadPool()
+{
+    static QThreadPool *pool = [] {
+        auto pool = new QThreadPool(qApp);
+        pool->setObjectName(QStringLiteral("ImageColors"));
+        pool->setMaxThreadCount(std::clamp(QThread::idealThreadCount() / 2, 1, 4));
+        return pool;
+    }();
+    return pool;
+}
+
+static std::atomic<int> s_maxThreads = [] {
+    bool ok = false;
+    const int threads = qEnvironmentVariableIntValue("KIRIGAMI_IMAGECOLORS_THREADS", &ok);
+    return ok ? std::max(1, threads) : std::clamp(QThread::idealThreadCount(), 1, 8);
+}();
+
+int ImageColors::maxThreads()
+{
+    return s_maxThreads;
+}
+
+void ImageColors::setMaxThreads(int maxThreads)
+{
+    s_maxThreads = std::max(1, maxThreads);
+}
+
+#if HAVE_OpenMP
+// Threads in the OpenMP teams of all palette generations running right now
+static std::atomic<int> s_busyThreads = 0;
+#else
+// Threads the chunks of a single palette generation run on. Kept apart from
+// threadPool(), whose threads block while waiting for their chunks.
+static QThreadPool *workerPool()
+{
+    static QThreadPool *pool = [] {
+        auto pool = new QThreadPool(qApp);
+        pool->setObjectName(QStringLiteral("ImageColorsWorkers"));
+        pool->setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+        return pool;
+    }();
+    return pool;
+}
+#endif
+
+// Calls function(chunk, begin, end) for up to numChunks contiguous ranges
+// covering [0, count) in order, each at least minimumChunkSize long, and
+// returns once all of them are done. The ranges only depend on the
+// arguments, so callers that merge per-chunk results by chunk index get
+// the same output whichever backend runs them, and however many threads
+// actually do.
+template<typename Function>
+static void parallelFor(int count, int numChunks, int minimumChunkSize, const Function &function)
+{
+    numChunks = std::clamp(count / std::max(1, minimumChunkSize), 1, std::max(1, numChunks));
+    const auto chunkBegin = [count, numChunks](int chunk) {
+        return int(qint64(count) * chunk / numChunks);
+    };
+
+    if (numChunks == 1) {
+        function(0, 0, count);
+        return;
+    }
+
+#if HAVE_OpenMP
+    // Several jobs of ImageColors::threadPool() may get here at once, each
+    // opening its own team. Split maxThreads() between their teams instead
+    // of giving each one that many threads; a job that finds none left runs
+    // its chunks alone.
+    int busyThreads = s_busyThreads.load();
+    int teamSize = 1;
+    do {
+        teamSize = std::clamp(ImageColors::maxThreads() - busyThreads, 1, numChunks);
+    } while (!s_busyThreads.compare_exchange_weak(busyThreads, busyThreads + teamSize));
+
+    // Use a num_threads clause rather than omp_set_num_threads(), which
+    // would change the defaults of the whole application.
+#pragma omp parallel for num_threads(teamSize) schedule(static, 1)
+    for (int chunk = 0; chunk < numChunks; ++chunk) {
+        function(chunk, chunkBegin(chunk), chunkBegin(chunk + 1));
+    } // END omp parallel for
+
+    s_busyThreads -= teamSize;
+#else
+    // Chunks that find no idle worker run right here, so a busy pool only
+    // makes this slower, never blocks it.
+    QSemaphore done;
+    for (int chunk = 1; chunk < numChunks; ++chunk) {
+        auto run = [&function, &done, chunk, begin = chunkBegin(chunk), end = chunkBegin(chunk + 1)]() {
+            function(chunk, begin, end);
+            done.release();
+        };
+        if (!workerPool()->tryStart(run)) {
+            run();
+        }
+    }
+    function(0, 0, chunkBegin(1));
+    done.acquire(numChunks - 1);
+#endif
+}
+
+QImage ImageColors::loadImage(const QString &path)
+{
+    // Let the decoder produce an image of roughly the size that gets
+    // sampled instead of decoding it at full resolution and discarding
+    // most of the pixels. Some image plugins (e.g. JPEG) do this at
+    // decode time, skipping most of the work and memory.
+    QImageReader reader(path);
+    const QSize size = reader.size();
+    if (size.isValid() && (size.width() > s_sourceSize || size.height() > s_sourceSize)) {
+        reader.setScaledSize(size.scaled(s_sourceSize, s_sourceSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1)));
+    }
+    return reader.read();
+}
+
+void ImageColors::loadSourceFile(const QString &path, const QVariant &source)
+{
+    QFuture<QImage> future = QtConcurrent::task(&ImageColors::loadImage).withArguments(path).onThreadPool(*threadPool()).withPriority(jobPriority()).spawn();
+    m_futureSourceImageData = new QFutureWatcher<QImage>(this);
+    connect(m_futureSourceImageData, &QFutureWatcher<QImage>::finished, this, [this, path, source]() {
+        if (m_futureSourceImageData->future().resultCount() == 0) {
+            return;
+        }
+        const QImage image = m_futureSourceImageData->future().result();
+        m_futureSourceImageData->deleteLater();
+        m_futureSourceImageData = nullptr;
+        clearSourceItem();
+        m_sourceFile = image.isNull() ? QString() : path;
+        m_sourceImage = image;
+        scheduleUpdate();
+        if (m_source != source) {
+            m_source = source;
+            Q_EMIT sourceChanged();
+        }
+    });
+    m_futureSourceImageData->setFuture(future);
+}
+
+int ImageColors::updateInterval() const
+{
+    return m_updateInterval;
+}
+
+void ImageColors::setUpdateInterval(int interval)
+{
+    interval = std::max(0, interval);
+    if (m_updateInterval == interval) {
+        return;
+    }
+
+    m_updateInterval = interval;
+    syncUpdateTimer();
+    Q_EMIT updateIntervalChanged();
+}
+
+// Continuous updates of all instances share this many grabs per second, so
+// that many of them following animated content cannot flood the render thread
+// with offscreen renders.
+static constexpr int s_maxContinuousGrabsPerSecond = 30;
+// Unchanged grabs stretch the interval up to 2^s_maxBackoff times
+static constexpr int s_maxBackoff = 4;
+
+static bool takeContinuousGrab()
+{
+    static QElapsedTimer second;
+    static int grabs = 0;
+    if (!second.isValid() || second.hasExpired(1000)) {
+        second.start();
+        grabs = 0;
+    }
+    if (grabs >= s_maxContinuousGrabsPerSecond) {
+        return false;
+    }
+    ++grabs;
+    return true;
+}
+
+void ImageColors::syncUpdateTimer()
+{
+    disconnect(m_frameSwappedConnection);
+
+    if (m_updateInterval <= 0 || !m_sourceItem) {
+        if (m_updateTimer) {
+            m_updateTimer->stop();
+        }
+        return;
+    }
+
+    if (!m_updateTimer) {
+        m_updateTimer = new QTimer(this);
+        connect(m_updateTimer, &QTimer::timeout, this, [this]() {
+            // Only sample content that was actually rendered since the last
+            // grab, and never queue a grab behind one still being analyzed.
+            if (!m_frameSwapped || m_updatePending || m_grabbing || m_futureImageData) {
+                return;
+            }
+            if (!takeContinuousGrab()) {
+                return; // Try again next time
+            }
+            m_frameSwapped = false;
+            scheduleUpdate();
+        });
+    }
+
+    if (m_window) {
+        m_frameSwappedConnection = connect(m_window, &QQuickWindow::frameSwapped, this, [this]() {
+            if (!std::exchange(m_grabFramePending, false)) {
+                m_frameSwapped = true;
+            }
+        });
+    }
+    const qint64 interval = qint64(m_updateInterval) << std::min(m_unchangedGrabs, s_maxBackoff);
+    m_updateTimer->setInterval(int(std::min<qint64>(interval, std::numeric_limits<int>::max())));
+    if (!m_updateTimer->isActive()) {
+        m_updateTimer->start();
+    }
+}
+
+void ImageColors::clearSourceItem()
 {
     if (m_window) {
         disconnect(m_window.data(), nullptr, this, nullptr);
@@ -142,9 +384,16 @@ void ImageColors::setSourceImage(const QImage &image)
     }
 
     m_sourceItem.clear();
+    syncUpdateTimer();
+}
+
+void ImageColors::setSourceImage(const QImage &image)
+{
+    clearSourceItem();
+    m_sourceFile.clear();
 
     m_sourceImage = image;
-    update();
+    scheduleUpdate();
 }
 
 QImage ImageColors::sourceImage() const
@@ -165,7 +414,8 @@ void ImageColors::setSourceItem(QQuickItem *source)
         disconnect(m_sourceItem, nullptr, this, nullptr);
     }
     m_sourceItem = source;
-    update();
+    m_sourceFile.clear();
+    scheduleUpdate();
 
     if (m_sourceItem) {
         auto syncWindow = [this]() {
@@ -174,13 +424,16 @@ void ImageColors::setSourceItem(QQuickItem *source)
             }
             m_window = m_sourceItem->window();
             if (m_window) {
-                connect(m_window, &QWindow::visibleChanged, this, &ImageColors::update);
+                connect(m_window, &QWindow::visibleChanged, this, &ImageColors::scheduleUpdate);
             }
-            update();
+            syncUpdateTimer();
+            scheduleUpdate();
         };
 
         connect(m_sourceItem, &QQuickItem::windowChanged, this, syncWindow);
         syncWindow();
+    } else {
+        syncUpdateTimer();
     }
 }
 
@@ -189,7 +442,57 @@ QQuickItem *ImageColors::sourceItem() const
     return m_sourceItem;
 }
 
+ImageColors::Quantizer ImageColors::quantizer() const
+{
+    return m_quantizer;
+}
+
+void ImageColors::setQuantizer(Quantizer quantizer)
+{
+    if (m_quantizer == quantizer) {
+        return;
+    }
+
+    m_quantizer = quantizer;
+    Q_EMIT quantizerChanged();
+    scheduleUpdate();
+}
+
+int ImageColors::jobPriority() const
+{
+    auto isShown = [](const QQuickItem *item) {
+        return item && item->isVisible() && item->window() && item->window()->isVisible();
+    };
+    if (isShown(m_sourceItem) || isShown(qobject_cast<QQuickItem *>(parent()))) {
+        return 1;
+    }
+    return 0;
+}
+
 void ImageColors::update()
+{
+    // Unlike automatic updates, an explicit one always reapplies the palette,
+    // e.g. because the colors of the theme it is adjusted to have changed.
+    scheduleUpdate();
+    m_forceUpdate = true;
+}
+
+void ImageColors::scheduleUpdate()
+{
+    // Stop obsolete work right away, but only start new work once per event
+    // loop iteration no matter how often the source changed in between.
+    const bool updatePending = m_updatePending;
+    const bool forceUpdate = m_forceUpdate;
+    cancelUpdate();
+
+    m_updatePending = true;
+    m_forceUpdate = forceUpdate;
+    if (!updatePending) {
+        QMetaObject::invokeMethod(this, &ImageColors::performUpdate, Qt::QueuedConnection);
+    }
+}
+
+void ImageColors::cancelUpdate()
 {
     if (m_futureImageData) {
         m_futureImageData->disconnect(this, nullptr);
@@ -197,23 +500,71 @@ void ImageColors::update()
         m_futureImageData->deleteLater();
         m_futureImageData = nullptr;
     }
+    if (m_grabResult) {
+        disconnect(m_grabResult.data(), nullptr, this, nullptr);
+        m_grabResult.clear();
+    }
+    m_grabbing = false;
+    m_updatePending = false;
+    m_forceUpdate = false;
+}
 
-    auto runUpdate = [this]() {
-        auto sourceImage{m_sourceImage};
-        QFuture<ImageData> future = QtConcurrent::run([sourceImage = std::move(sourceImage)]() {
-            return generatePalette(sourceImage);
-        });
+void ImageColors::performUpdate()
+{
+    if (!m_updatePending) {
+        return; // Canceled since it was queued
+    }
+    m_updatePending = false;
+    const bool force = std::exchange(m_forceUpdate, false);
+
+    auto runUpdate = [this, force]() {
+        const QByteArray cacheKey = m_sourceFile.isEmpty() ? ImageColorsCache::keyForImage(m_sourceImage, m_quantizer)
+                                                           : ImageColorsCache::keyForFile(m_sourceFile, m_quantizer);
+        if (cacheKey.isEmpty()) {
+            clearImageData(); // Nothing to sample, e.g. an empty grab
+            return;
+        }
+        if (cacheKey == m_imageDataKey && !force) {
+            // Same pixels as the last update, sample less often
+            if (m_updateTimer && m_updateTimer->isActive() && m_unchangedGrabs < s_maxBackoff) {
+                ++m_unchangedGrabs;
+                syncUpdateTimer();
+            }
+            return;
+        }
+        if (m_unchangedGrabs > 0) {
+            m_unchangedGrabs = 0;
+            syncUpdateTimer();
+        }
+        if (const auto imageData = ImageColorsCache::find(cacheKey)) {
+            applyImageData(*imageData, cacheKey);
+            return;
+        }
+
+        auto generate = [](QPromise<ImageData> &promise, const QImage &sourceImage, Quantizer quantizer) {
+            ImageData imageData = generatePalette(sourceImage, quantizer, [&promise]() {
+                return promise.isCanceled();
+            });
+            if (!promise.isCanceled()) {
+                promise.addResult(std::move(imageData));
+            }
+        };
+        QFuture<ImageData> future = QtConcurrent::task(std::move(generate))
+                                        .withArguments(m_sourceImage, m_quantizer)
+                                        .onThreadPool(*threadPool())
+                                        .withPriority(jobPriority())
+                                        .spawn();
         m_futureImageData = new QFutureWatcher<ImageData>(this);
-        connect(m_futureImageData, &QFutureWatcher<ImageData>::finished, this, [this]() {
-            if (!m_futureImageData) {
+        connect(m_futureImageData, &QFutureWatcher<ImageData>::finished, this, [this, cacheKey]() {
+            if (!m_futureImageData || m_futureImageData->future().resultCount() == 0) {
                 return;
             }
-            m_imageData = m_futureImageData->future().result();
-            postProcess(m_imageData);
+            const ImageData imageData = m_futureImageData->future().result();
             m_futureImageData->deleteLater();
             m_futureImageData = nullptr;
 
-            Q_EMIT paletteChanged();
+            ImageColorsCache::insert(cacheKey, imageData);
+            applyImageData(imageData, cacheKey);
         });
         m_futureImageData->setFuture(future);
     };
@@ -221,22 +572,27 @@ void ImageColors::update()
     if (!m_sourceItem || !m_sourceItem->window() || !m_sourceItem->window()->isVisible()) {
         if (!m_sourceImage.isNull()) {
             runUpdate();
+        } else if (!m_sourceFile.isEmpty()) {
+            // The palette came from the cache without decoding the file
+            const QByteArray cacheKey = ImageColorsCache::keyForFile(m_sourceFile, m_quantizer);
+            if (const auto imageData = ImageColorsCache::find(cacheKey)) {
+                applyImageData(*imageData, cacheKey);
+            } else if (!m_futureSourceImageData) {
+                loadSourceFile(m_sourceFile, m_source);
+            }
         } else {
-            m_imageData = {};
-            Q_EMIT paletteChanged();
+            clearImageData();
         }
         return;
     }
 
-    if (m_grabResult) {
-        disconnect(m_grabResult.data(), nullptr, this, nullptr);
-        m_grabResult.clear();
-    }
-
-    m_grabResult = m_sourceItem->grabToImage(QSize(128, 128));
+    m_grabResult = m_sourceItem->grabToImage(QSize(s_sourceSize, s_sourceSize));
 
     if (m_grabResult) {
+        m_grabbing = true;
+        m_grabFramePending = true;
         connect(m_grabResult.data(), &QQuickItemGrabResult::ready, this, [this, runUpdate]() {
+            m_grabbing = false;
             m_sourceImage = m_grabResult->image();
             runUpdate();
         });
@@ -245,6 +601,22 @@ void ImageColors::update()
     }
 }
 
+void ImageColors::applyImageData(const ImageData &imageData, const QByteArray &cacheKey)
+{
+    m_imageData = imageData;
+    m_imageDataKey = cacheKey;
+    postProcess(m_imageData);
+
+    Q_EMIT paletteChanged();
+}
+
+void ImageColors::clearImageData()
+{
+    m_imageData = {};
+    m_imageDataKey.clear();
+    Q_EMIT paletteChanged();
+}
+
 static inline int squareDistance(QRgb color1, QRgb color2)
 {
     // https://en.wikipedia.org/wiki/Color_difference
@@ -275,32 +647,23 @@ void ImageColors::positionColor(QRgb rgb, QList<ImageData::colorStat> &clusters)
     clusters << stat;
 }
 
-void ImageColors::positionColorMP(const decltype(ImageData::m_samples) &samples, decltype(ImageData::m_clusters) &clusters, int numCore)
+void ImageColors::positionColorMP(const decltype(ImageData::m_samples) &samples, decltype(ImageData::m_clusters) &clusters, int numThreads)
 {
-#if HAVE_OpenMP
-    if (samples.size() < 65536 /* 256^2 */ || numCore < 2) {
-#else
-    if (true) {
-#endif
+    if (samples.size() < 65536 /* 256^2 */ || numThreads < 2) {
         // Fall back to single thread
         for (auto color : samples) {
             positionColor(color, clusters);
         }
         return;
     }
-#if HAVE_OpenMP
-    // Split the whole samples into multiple parts
-    const int numSamplesPerThread = samples.size() / numCore;
-    std::vector<decltype(ImageData::m_clusters)> tempClusters(numCore, decltype(ImageData::m_clusters){});
-#pragma omp parallel for
-    for (int i = 0; i < numCore; ++i) {
-        const auto beginIt = std::next(samples.begin(), numSamplesPerThread * i);
-        const auto endIt = i < numCore - 1 ? std::next(samples.begin(), numSamplesPerThread * (i + 1)) : samples.end();
 
-        for (auto it = beginIt; it != endIt; it = std::next(it)) {
-            positionColor(*it, tempClusters[omp_get_thread_num()]);
+    // Split the whole samples into multiple parts
+    std::vector<decltype(ImageData::m_clusters)> tempClusters(numThreads, decltype(ImageData::m_clusters){});
+    parallelFor(samples.size(), numThreads, 1, [&samples, &tempClusters](int chunk, int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            positionColor(samples[i], tempClusters[chunk]);
         }
-    } // END omp parallel for
+    });
 
     // Restore clusters
     // Don't use std::as_const as memory will grow significantly
@@ -329,12 +692,223 @@ void ImageColors::positionColorMP(const decltype(ImageData::m_samples) &samples,
         return stat.colors.empty();
     });
     clusters.erase(removeIt, clusters.end());
+}
+
+void ImageColors::quantizeHistogram(ImageData &imageData)
+{
+    // 5 bits per channel. Each bin keeps the channel sums of its samples so
+    // that it is represented by their mean rather than by the bin center.
+    constexpr int binBits = 5;
+    constexpr int binShift = 8 - binBits;
+    constexpr int binCount = 1 << (3 * binBits);
+
+    // A single bin can hold every sample of a large solid image, 32 bit
+    // channel sums would overflow at about 16.8M of them.
+    struct Bin {
+        quint64 weight = 0;
+        quint64 r = 0;
+        quint64 g = 0;
+        quint64 b = 0;
+    };
+    std::vector<Bin> bins(binCount);
+
+    for (const QRgb rgb : std::as_const(imageData.m_samples)) {
+        const int r = qRed(rgb);
+        const int g = qGreen(rgb);
+        const int b = qBlue(rgb);
+        auto &bin = bins[((r >> binShift) << (2 * binBits)) | ((g >> binShift) << binBits) | (b >> binShift)];
+        ++bin.weight;
+        bin.r += r;
+        bin.g += g;
+        bin.b += b;
+    }
+
+    struct WeightedColor {
+        QRgb color;
+        quint64 weight;
+    };
+    std::vector<WeightedColor> colors;
+    for (const auto &bin : bins) {
+        if (bin.weight > 0) {
+            colors.push_back({qRgb(int(bin.r / bin.weight), int(bin.g / bin.weight), int(bin.b / bin.weight)), bin.weight});
+        }
+    }
+    // Heavier bins first, so they seed the clusters like the most common
+    // colors would in the per-sample clustering.
+    std::stable_sort(colors.begin(), colors.end(), [](const WeightedColor &a, const WeightedColor &b) {
+        return a.weight > b.weight;
+    });
+
+    struct WeightedCluster {
+        QRgb centroid;
+        qint64 weight = 0;
+        qint64 r = 0;
+        qint64 g = 0;
+        qint64 b = 0;
+    };
+    std::vector<WeightedCluster> clusters;
+
+    auto assign = [&clusters](const WeightedColor &color) {
+        auto it = std::find_if(clusters.begin(), clusters.end(), [&color](const WeightedCluster &cluster) {
+            return squareDistance(color.color, cluster.centroid) < s_minimumSquareDistance;
+        });
+        if (it == clusters.end()) {
+            clusters.push_back({color.color});
+            it = std::prev(clusters.end());
+        }
+        const qint64 weight = color.weight;
+        it->weight += weight;
+        it->r += qRed(color.color) * weight;
+        it->g += qGreen(color.color) * weight;
+        it->b += qBlue(color.color) * weight;
+    };
+
+    for (const auto &color : colors) {
+        assign(color);
+    }
+
+    for (int iteration = 0; iteration < 5; ++iteration) {
+        for (auto &cluster : clusters) {
+            cluster.centroid = qRgb(cluster.r / cluster.weight, cluster.g / cluster.weight, cluster.b / cluster.weight);
+            cluster.weight = 0;
+            cluster.r = 0;
+            cluster.g = 0;
+            cluster.b = 0;
+        }
+        for (const auto &color : colors) {
+            assign(color);
+        }
+        clusters.erase(std::remove_if(clusters.begin(),
+                                      clusters.end(),
+                                      [](const WeightedCluster &cluster) {
+                                          return cluster.weight == 0;
+                                      }),
+                       clusters.end());
+    }
+
+    const qreal total = imageData.m_samples.size();
+    imageData.m_clusters.reserve(clusters.size());
+    for (const auto &cluster : clusters) {
+        ImageData::colorStat stat;
+        stat.centroid = qRgb(cluster.r / cluster.weight, cluster.g / cluster.weight, cluster.b / cluster.weight);
+        stat.ratio = std::clamp(qreal(cluster.weight) / total, 0.0, 1.0);
+        imageData.m_clusters << stat;
+    }
+}
+
+struct SampleBuffer {
+    QList<QRgb> samples;
+    qint64 r = 0;
+    qint64 g = 0;
+    qint64 b = 0;
+};
+
+// Scalar tail of the sampling kernel. Pixels reaching this point are known to
+// be visible; only the chroma test remains. Runs of identical pixels are very
+// common in artwork, so the last decision is memoized.
+static inline void samplePixel(QRgb pixel, SampleBuffer &buffer, QRgb &lastPixel, bool &lastAccepted)
+{
+    if (pixel != lastPixel) {
+        lastPixel = pixel;
+        lastAccepted = ColorUtils::chromaRgb(pixel) >= 20;
+    }
+    if (!lastAccepted) {
+        return;
+    }
+    const QRgb rgb = pixel | 0xff000000;
+    buffer.samples << rgb;
+    buffer.r += qRed(rgb);
+    buffer.g += qGreen(rgb);
+    buffer.b += qBlue(rgb);
+}
+
+// A pixel can only ever be sampled if it is not fully transparent and not a
+// pure gray (r == g == b has a CIELAB chroma of ~0, well below the threshold).
+// Both tests only need integer bit operations, so they are evaluated for
+// several pixels at once and the expensive chroma test only runs on survivors.
+static inline bool isCandidatePixel(QRgb pixel)
+{
+    return (pixel & 0xff000000) != 0 && ((pixel ^ (pixel >> 8)) & 0xffff) != 0;
+}
+
+// Appends every sample of one ARGB32 scanline to buffer.
+static void sampleScanLine(const QRgb *line, int width, SampleBuffer &buffer)
+{
+    QRgb lastPixel = 0;
+    bool lastAccepted = false;
+    int x = 0;
+
+#if defined(__AVX2__)
+    {
+        const __m256i alphaMask = _mm256_set1_epi32(int(0xff000000));
+        const __m256i colorMask = _mm256_set1_epi32(0x0000ffff);
+        const __m256i zero = _mm256_setzero_si256();
+        for (; x + 8 <= width; x += 8) {
+            const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(line + x));
+            const __m256i transparent = _mm256_cmpeq_epi32(_mm256_and_si256(pixels, alphaMask), zero);
+            const __m256i gray = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_xor_si256(pixels, _mm256_srli_epi32(pixels, 8)), colorMask), zero);
+            int candidates = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(transparent, gray))) & 0xff;
+            while (candidates) {
+                const int i = qCountTrailingZeroBits(uint(candidates));
+                samplePixel(line[x + i], buffer, lastPixel, lastAccepted);
+                candidates &= candidates - 1;
+            }
+        }
+    }
+#endif
+#if defined(KIRIGAMI_IMAGECOLORS_SSE2)
+    {
+        const __m128i alphaMask = _mm_set1_epi32(int(0xff000000));
+        const __m128i colorMask = _mm_set1_epi32(0x0000ffff);
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 4 <= width; x += 4) {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(line + x));
+            const __m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(pixels, alphaMask), zero);
+            const __m128i gray = _mm_cmpeq_epi32(_mm_and_si128(_mm_xor_si128(pixels, _mm_srli_epi32(pixels, 8)), colorMask), zero);
+            int candidates = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(transparent, gray))) & 0xf;
+            while (candidates) {
+                const int i = qCountTrailingZeroBits(uint(candidates));
+                samplePixel(line[x + i], buffer, lastPixel, lastAccepted);
+                candidates &= candidates - 1;
+            }
+        }
+    }
+#elif defined(KIRIGAMI_IMAGECOLORS_NEON)
+    {
+        const uint32x4_t alphaMask = vdupq_n_u32(0xff000000);
+        const uint32x4_t colorMask = vdupq_n_u32(0x0000ffff);
+        const uint32x4_t zero = vdupq_n_u32(0);
+        for (; x + 4 <= width; x += 4) {
+            const uint32x4_t pixels = vld1q_u32(reinterpret_cast<const uint32_t *>(line + x));
+            const uint32x4_t transparent = vceqq_u32(vandq_u32(pixels, alphaMask), zero);
+            const uint32x4_t gray = vceqq_u32(vandq_u32(veorq_u32(pixels, vshrq_n_u32(pixels, 8)), colorMask), zero);
+            const uint32x4_t candidates = vmvnq_u32(vorrq_u32(transparent, gray));
+            const uint32x2_t folded = vorr_u32(vget_low_u32(candidates), vget_high_u32(candidates));
+            if (vget_lane_u64(vreinterpret_u64_u32(folded), 0) == 0) {
+                continue;
+            }
+            for (int i = 0; i < 4; ++i) {
+                if (isCandidatePixel(line[x + i])) {
+                    samplePixel(line[x + i], buffer, lastPixel, lastAccepted);
+                }
+            }
+        }
+    }
 #endif
+
+    for (; x < width; ++x) {
+        if (isCandidatePixel(line[x])) {
+            samplePixel(line[x], buffer, lastPixel, lastAccepted);
+        }
+    }
 }
 
-ImageData ImageColors::generatePalette(const QImage &sourceImage)
+ImageData ImageColors::generatePalette(const QImage &sourceImage, Quantizer quantizer, const std::function<bool()> &isCanceled)
 {
     ImageData imageData;
+    auto canceled = [&isCanceled]() {
+        return isCanceled && isCanceled();
+    };
 
     if (sourceImage.isNull() || sourceImage.width() == 0) {
         return imageData;
@@ -343,69 +917,85 @@ ImageData ImageColors::generatePalette(const QImage &sourceImage)
     imageData.m_clusters.clear();
     imageData.m_samples.clear();
 
-#if HAVE_OpenMP
-    static const int numCore = std::min(8, omp_get_num_procs());
-    omp_set_num_threads(numCore);
-#else
-    constexpr int numCore = 1;
-#endif
-    int r = 0;
-    int g = 0;
-    int b = 0;
-    int c = 0;
-
-#pragma omp parallel for collapse(2) reduction(+ : r) reduction(+ : g) reduction(+ : b) reduction(+ : c)
-    for (int x = 0; x < sourceImage.width(); ++x) {
-        for (int y = 0; y < sourceImage.height(); ++y) {
-            const QColor sampleColor = sourceImage.pixelColor(x, y);
-            if (sampleColor.alpha() == 0) {
-                continue;
-            }
-            if (ColorUtils::chroma(sampleColor) < 20) {
-                continue;
-            }
-            QRgb rgb = sampleColor.rgb();
-            ++c;
-            r += qRed(rgb);
-            g += qGreen(rgb);
-            b += qBlue(rgb);
-#pragma omp critical
-            imageData.m_samples << rgb;
+    const int numThreads = maxThreads();
+
+    // Sample row by row from a fixed non-premultiplied format, each chunk of
+    // rows writing into its own buffer. Concatenating the buffers afterwards
+    // in chunk order yields the same sample order as a serial run.
+    const QImage image = sourceImage.convertToFormat(QImage::Format_ARGB32);
+    const int width = image.width();
+    const int height = image.height();
+
+    std::vector<SampleBuffer> buffers(numThreads);
+    parallelFor(height, numThreads, 16, [&](int chunk, int begin, int end) {
+        for (int y = begin; y < end && !canceled(); ++y) {
+            sampleScanLine(reinterpret_cast<const QRgb *>(image.constScanLine(y)), width, buffers[chunk]);
         }
-    } // END omp parallel for
+    });
+
+    if (canceled()) {
+        return {};
+    }
+
+    qsizetype count = 0;
+    qint64 red = 0;
+    qint64 green = 0;
+    qint64 blue = 0;
+    for (const auto &buffer : buffers) {
+        count += buffer.samples.size();
+    }
+    imageData.m_samples.reserve(count);
+    for (const auto &buffer : buffers) {
+        imageData.m_samples.append(buffer.samples);
+        red += buffer.r;
+        green += buffer.g;
+        blue += buffer.b;
+    }
 
     if (imageData.m_samples.isEmpty()) {
         return imageData;
     }
 
-    positionColorMP(imageData.m_samples, imageData.m_clusters, numCore);
+    imageData.m_average = QColor(int(red / count), int(green / count), int(blue / count), 255);
 
-    imageData.m_average = QColor(r / c, g / c, b / c, 255);
+    if (quantizer == Histogram) {
+        quantizeHistogram(imageData);
+    } else {
+        positionColorMP(imageData.m_samples, imageData.m_clusters, numThreads);
+
+        for (int iteration = 0; iteration < 5; ++iteration) {
+            parallelFor(imageData.m_clusters.size(), numThreads, 64, [&imageData](int, int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    auto &stat = imageData.m_clusters[i];
+                    int r = 0;
+                    int g = 0;
+                    int b = 0;
+                    int c = 0;
+
+                    for (auto color : std::as_const(stat.colors)) {
+                        c++;
+                        r += qRed(color);
+                        g += qGreen(color);
+                        b += qBlue(color);
+                    }
+                    r = r / c;
+                    g = g / c;
+                    b = b / c;
+                    stat.centroid = qRgb(r, g, b);
+                    stat.ratio = std::clamp(qreal(stat.colors.count()) / qreal(imageData.m_samples.count()), 0.0, 1.0);
+                    stat.colors = QList<QRgb>({stat.centroid});
+                }
+            });
 
-    for (int iteration = 0; iteration < 5; ++iteration) {
-#pragma omp parallel for private(r, g, b, c)
-        for (int i = 0; i < imageData.m_clusters.size(); ++i) {
-            auto &stat = imageData.m_clusters[i];
-            r = 0;
-            g = 0;
-            b = 0;
-            c = 0;
-
-            for (auto color : std::as_const(stat.colors)) {
-                c++;
-                r += qRed(color);
-                g += qGreen(color);
-                b += qBlue(color);
+            if (canceled()) {
+                return {};
             }
-            r = r / c;
-            g = g / c;
-            b = b / c;
-            stat.centroid = qRgb(r, g, b);
-            stat.ratio = std::clamp(qreal(stat.colors.count()) / qreal(imageData.m_samples.count()), 0.0, 1.0);
-            stat.colors = QList<QRgb>({stat.centroid});
-        } // END omp parallel for
+            positionColorMP(imageData.m_samples, imageData.m_clusters, numThreads);
+        }
+    }
 
-        positionColorMP(imageData.m_samples, imageData.m_clusters, numCore);
+    if (canceled()) {
+        return {};
     }
 
     std::sort(imageData.m_clusters.begin(), imageData.m_clusters.end(), [](const ImageData::colorStat &a, const ImageData::colorStat &b) {
@@ -444,62 +1034,69 @@ ImageData ImageColors::generatePalette(const QImage &sourceImage)
 
     bool first = true;
 
-#pragma omp parallel for ordered
-    for (int i = 0; i < imageData.m_clusters.size(); ++i) {
-        const auto &stat = imageData.m_clusters[i];
-        const QColor color(stat.centroid);
-
-        QColor contrast = QColor(255 - color.red(), 255 - color.green(), 255 - color.blue());
-        contrast.setHsl(contrast.hslHue(), //
-                        contrast.hslSaturation(), //
-                        128 + (128 - contrast.lightness()));
-        QColor tempContrast;
-        int minimumDistance = 4681800; // max distance: 4*3*2*3*255*255
-        for (const auto &stat : std::as_const(imageData.m_clusters)) {
-            const int distance = squareDistance(contrast.rgb(), stat.centroid);
-
-            if (distance < minimumDistance) {
-                tempContrast = QColor(stat.centroid);
-                minimumDistance = distance;
+    // Finding the contrasting color of each cluster compares it with all the
+    // others, which is done in parallel; collecting the results is not.
+    std::vector<QColor> contrasts(imageData.m_clusters.size());
+    parallelFor(imageData.m_clusters.size(), numThreads, 16, [&imageData, &contrasts](int, int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            const QColor color(imageData.m_clusters[i].centroid);
+
+            QColor contrast = QColor(255 - color.red(), 255 - color.green(), 255 - color.blue());
+            contrast.setHsl(contrast.hslHue(), //
+                            contrast.hslSaturation(), //
+                            128 + (128 - contrast.lightness()));
+            QColor tempContrast;
+            int minimumDistance = 4681800; // max distance: 4*3*2*3*255*255
+            for (const auto &stat : std::as_const(imageData.m_clusters)) {
+                const int distance = squareDistance(contrast.rgb(), stat.centroid);
+
+                if (distance < minimumDistance) {
+                    tempContrast = QColor(stat.centroid);
+                    minimumDistance = distance;
+                }
             }
-        }
 
-        if (imageData.m_clusters.size() <= 3) {
-            if (qGray(imageData.m_dominant.rgb()) < 120) {
-                contrast = QColor(230, 230, 230);
+            if (imageData.m_clusters.size() <= 3) {
+                if (qGray(imageData.m_dominant.rgb()) < 120) {
+                    contrast = QColor(230, 230, 230);
+                } else {
+                    contrast = QColor(20, 20, 20);
+                }
+                // TODO: replace m_clusters.size() > 3 with entropy calculation
+            } else if (squareDistance(contrast.rgb(), tempContrast.rgb()) < s_minimumSquareDistance * 1.5) {
+                contrast = tempContrast;
             } else {
-                contrast = QColor(20, 20, 20);
+                contrast = tempContrast;
+                contrast.setHsl(contrast.hslHue(),
+                                contrast.hslSaturation(),
+                                contrast.lightness() > 128 ? qMin(contrast.lightness() + 20, 255) : qMax(0, contrast.lightness() - 20));
             }
-            // TODO: replace m_clusters.size() > 3 with entropy calculation
-        } else if (squareDistance(contrast.rgb(), tempContrast.rgb()) < s_minimumSquareDistance * 1.5) {
-            contrast = tempContrast;
-        } else {
-            contrast = tempContrast;
-            contrast.setHsl(contrast.hslHue(),
-                            contrast.hslSaturation(),
-                            contrast.lightness() > 128 ? qMin(contrast.lightness() + 20, 255) : qMax(0, contrast.lightness() - 20));
+            contrasts[i] = contrast;
         }
+    });
 
-#pragma omp ordered
-        { // BEGIN omp ordered
-            if (first) {
-                imageData.m_dominantContrast = contrast;
-                imageData.m_dominant = color;
-            }
-            first = false;
+    for (int i = 0; i < imageData.m_clusters.size(); ++i) {
+        const auto &stat = imageData.m_clusters[i];
+        const QColor color(stat.centroid);
+        const QColor &contrast = contrasts[i];
 
-            if (!imageData.m_highlight.isValid() || ColorUtils::chroma(color) > ColorUtils::chroma(imageData.m_highlight)) {
-                imageData.m_highlight = color;
-            }
+        if (first) {
+            imageData.m_dominantContrast = contrast;
+            imageData.m_dominant = color;
+        }
+        first = false;
 
-            if (qGray(color.rgb()) > qGray(imageData.m_closestToWhite.rgb())) {
-                imageData.m_closestToWhite = color;
-            }
-            if (qGray(color.rgb()) < qGray(imageData.m_closestToBlack.rgb())) {
-                imageData.m_closestToBlack = color;
-            }
-            imageData.m_palette << PaletteSwatch(stat.ratio, color, contrast);
-        } // END omp ordered
+        if (!imageData.m_highlight.isValid() || ColorUtils::chroma(color) > ColorUtils::chroma(imageData.m_highlight)) {
+            imageData.m_highlight = color;
+        }
+
+        if (qGray(color.rgb()) > qGray(imageData.m_closestToWhite.rgb())) {
+            imageData.m_closestToWhite = color;
+        }
+        if (qGray(color.rgb()) < qGray(imageData.m_closestToBlack.rgb())) {
+            imageData.m_closestToBlack = color;
+        }
+        imageData.m_palette << PaletteSwatch(stat.ratio, color, contrast);
     }
 
     return imageData;
@@ -507,20 +1104,24 @@ ImageData ImageColors::generatePalette(const QImage &sourceImage)
 
 double ImageColors::getClusterScore(const ImageData::colorStat &stat)
 {
-    return stat.ratio * ColorUtils::chroma(QColor(stat.centroid));
+    return stat.ratio * ColorUtils::chromaRgb(stat.centroid);
 }
 
 void ImageColors::postProcess(ImageData &imageData) const
 {
-    constexpr short unsigned WCAG_NON_TEXT_CONTRAST_RATIO = 3;
-    constexpr qreal WCAG_TEXT_CONTRAST_RATIO = 4.5;
-
-    auto platformTheme = qmlAttachedPropertiesObject<Kirigami::Platform::PlatformTheme>(this, false);
+    auto platformTheme = static_cast<Kirigami::Platform::PlatformTheme *>(qmlAttachedPropertiesObject<Kirigami::Platform::PlatformTheme>(this, false));
     if (!platformTheme) {
         return;
     }
 
-    const QColor backgroundColor = static_cast<Kirigami::Platform::PlatformTheme *>(platformTheme)->backgroundColor();
+    postProcess(imageData, platformTheme->backgroundColor(), platformTheme->textColor());
+}
+
+void ImageColors::postProcess(ImageData &imageData, const QColor &backgroundColor, const QColor &textColor)
+{
+    constexpr short unsigned WCAG_NON_TEXT_CONTRAST_RATIO = 3;
+    constexpr qreal WCAG_TEXT_CONTRAST_RATIO = 4.5;
+
     const qreal backgroundLum = ColorUtils::luminance(backgroundColor);
     qreal lowerLum, upperLum;
     // 192 is from kcm_colors
@@ -531,8 +1132,6 @@ void ImageColors::postProcess(ImageData &imageData) const
     } else {
         // For light themes, still prefer lighter colors
         // (lowerLum + 0.05) / (textLum + 0.05) >= 4.5
-        const QColor textColor =
-            static_cast<Kirigami::Platform::PlatformTheme *>(qmlAttachedPropertiesObject<Kirigami::Platform::PlatformTheme>(this, true))->textColor();
         const qreal textLum = ColorUtils::luminance(textColor);
         lowerLum = WCAG_TEXT_CONTRAST_RATIO * (textLum + 0.05) - 0.05;
         upperLum = backgroundLum;
@@ -555,10 +1154,10 @@ void ImageColors::postProcess(ImageData &imageData) const
         const qreal h = color.hslHueF();
         const qreal s = color.hslSaturationF();
         const qreal l = color.lightnessF();
-        while (ColorUtils::luminance(color.rgb()) < lowerLum && colorOperationCount++ < 10) {
+        while (ColorUtils::luminanceRgb(color.rgb()) < lowerLum && colorOperationCount++ < 10) {
             color.setHslF(h, s, std::min(1.0, l + colorOperationCount * 0.03));
         }
-        while (ColorUtils::luminance(color.rgb()) > upperLum && colorOperationCount++ < 10) {
+        while (ColorUtils::luminanceRgb(color.rgb()) > upperLum && colorOperationCount++ < 10) {
             color.setHslF(h, s, std::max(0.0, l - colorOperationCount * 0.03));
         }
     };
@@ -15,6 +15,10 @@
 #include <QQuickItem>
 #include <QQuickItemGrabResult>
 #include <QQuickWindow>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <functional>
 
 #include <platform/colorutils.h>
 
@@ -115,7 +119,7 @@ class ImageColors : public QObject
      * \endlist
      *
      * Note that an Item's color palette will only be extracted once unless you
-     * call update(), regardless of how the item hanges.
+     * call update() or set updateInterval, regardless of how the item hanges.
      */
     Q_PROPERTY(QVariant source READ source WRITE setSource NOTIFY sourceChanged FINAL)
 
@@ -293,7 +297,49 @@ class ImageColors : public QObject
      */
     Q_PROPERTY(QColor fallbackBackground MEMBER m_fallbackBackground NOTIFY fallbackBackgroundChanged FINAL)
 
+    /*!
+     * \qmlproperty enumeration ImageColors::quantizer
+     *
+     * The algorithm used to group the sampled colors into palette clusters.
+     *
+     * Possible values are:
+     * \list
+     * \li ImageColors.KMeans: every sampled pixel is assigned to a cluster
+     *     individually. Cost grows with the number of sampled pixels. This is
+     *     the default.
+     * \li ImageColors.Histogram: samples are first binned into a histogram
+     *     with 5 bits per channel and the bins are clustered weighted by their
+     *     pixel count. Cost grows with the number of distinct colors.
+     * \endlist
+     *
+     * Both algorithms produce the same set of properties; the exact colors
+     * may differ slightly.
+     */
+    Q_PROPERTY(Quantizer quantizer READ quantizer WRITE setQuantizer NOTIFY quantizerChanged FINAL)
+
+    /*!
+     * \qmlproperty int ImageColors::updateInterval
+     *
+     * When source is an Item, keep following its contents by grabbing it again
+     * at most every updateInterval milliseconds, and only after its window
+     * rendered a new frame other than the one of the previous grab, and that
+     * grab has been analyzed. The palette is only recomputed when the grabbed
+     * pixels actually changed. Each grab that finds the same pixels doubles
+     * the interval, up to 16 times updateInterval, until they change again.
+     * All ImageColors share a budget of 30 such grabs per second.
+     *
+     * This allows palettes to follow video or animated content. The default
+     * value is 0, which disables continuous updates.
+     */
+    Q_PROPERTY(int updateInterval READ updateInterval WRITE setUpdateInterval NOTIFY updateIntervalChanged FINAL)
+
 public:
+    enum Quantizer {
+        KMeans,
+        Histogram,
+    };
+    Q_ENUM(Quantizer)
+
     explicit ImageColors(QObject *parent = nullptr);
     ~ImageColors() override;
 
@@ -306,10 +352,25 @@ public:
     void setSourceItem(QQuickItem *source);
     QQuickItem *sourceItem() const;
 
+    Quantizer quantizer() const;
+    void setQuantizer(Quantizer quantizer);
+
+    int updateInterval() const;
+    void setUpdateInterval(int interval);
+
     /*!
      * \qmlmethod void ImageColors::update()
      *
      * Updates the colors
+     *
+     * Several calls within the same event loop iteration result in a single update.
+     * paletteChanged is emitted once it is done, even if the source did not
+     * change; use this to follow changes of the theme colors the palette is
+     * adjusted to. Updates triggered by the source, or by updateInterval,
+     * only emit paletteChanged when the sampled pixels changed.
+     *
+     * Palettes are shared between all instances, so one that was already
+     * generated for the same pixels is applied right away.
      */
     Q_INVOKABLE void update();
 
@@ -324,6 +385,24 @@ public:
     QColor closestToWhite() const;
     QColor closestToBlack() const;
 
+    // Not for QML, building blocks shared with ImageColorsProxyModel
+
+    // Pool all palette related jobs run on
+    static QThreadPool *threadPool();
+    // Maximum number of threads a single palette generation is split across,
+    // 1 disables parallelism. With OpenMP, also the number of threads shared
+    // by all generations running at once. Defaults to
+    // KIRIGAMI_IMAGECOLORS_THREADS if set, otherwise to the number of cores,
+    // up to 8.
+    static int maxThreads();
+    static void setMaxThreads(int maxThreads);
+    // Decodes the image file at path, downscaled for sampling
+    static QImage loadImage(const QString &path);
+    // isCanceled is polled at checkpoints, an empty ImageData is returned once it returns true
+    static ImageData generatePalette(const QImage &sourceImage, Quantizer quantizer = KMeans, const std::function<bool()> &isCanceled = {});
+    // Adjusts the palette for legibility against the given theme colors
+    static void postProcess(ImageData &imageData, const QColor &backgroundColor, const QColor &textColor);
+
 Q_SIGNALS:
     void sourceChanged();
     void paletteChanged();
@@ -335,25 +414,57 @@ Q_SIGNALS:
     void fallbackHighlightChanged();
     void fallbackForegroundChanged();
     void fallbackBackgroundChanged();
+    void quantizerChanged();
+    void updateIntervalChanged();
 
 private:
     static inline void positionColor(QRgb rgb, QList<ImageData::colorStat> &clusters);
-    static void positionColorMP(const decltype(ImageData::m_samples) &samples, decltype(ImageData::m_clusters) &clusters, int numCore = 0);
-    static ImageData generatePalette(const QImage &sourceImage);
+    static void positionColorMP(const decltype(ImageData::m_samples) &samples, decltype(ImageData::m_clusters) &clusters, int numThreads = 1);
+    static void quantizeHistogram(ImageData &imageData);
 
     static double getClusterScore(const ImageData::colorStat &stat);
     void postProcess(ImageData &imageData) const;
+    void applyImageData(const ImageData &imageData, const QByteArray &cacheKey);
+    void clearImageData();
+    void syncUpdateTimer();
+
+    void clearSourceItem();
+    void loadSourceFile(const QString &path, const QVariant &source);
+    void scheduleUpdate();
+    void cancelUpdate();
+    void performUpdate();
+    int jobPriority() const;
 
     // Arbitrary number that seems to work well
     static const int s_minimumSquareDistance = 32000;
+    // Size at which items, icons and files are sampled
+    static const int s_sourceSize = 128;
     QPointer<QQuickWindow> m_window;
     QVariant m_source;
     QPointer<QQuickItem> m_sourceItem;
     QSharedPointer<QQuickItemGrabResult> m_grabResult;
     QImage m_sourceImage;
+    // Set when the source is a file, identifies it in the palette cache
+    QString m_sourceFile;
+    Quantizer m_quantizer = KMeans;
     QFutureWatcher<QImage> *m_futureSourceImageData = nullptr;
 
     QFutureWatcher<ImageData> *m_futureImageData = nullptr;
+    bool m_updatePending = false;
+    // Set by update(), reapplies the palette even if the pixels did not change
+    bool m_forceUpdate = false;
+    // Identifies the pixels m_imageData was computed from
+    QByteArray m_imageDataKey;
+
+    int m_updateInterval = 0;
+    QTimer *m_updateTimer = nullptr;
+    QMetaObject::Connection m_frameSwappedConnection;
+    bool m_frameSwapped = false;
+    // The next frame renders our own grab, it does not show new content
+    bool m_grabFramePending = false;
+    // Consecutive grabs with the same pixels, backs off continuous updates
+    int m_unchangedGrabs = 0;
+    bool m_grabbing = false;
     ImageData m_imageData;
 
     QList<PaletteSwatch> m_fallbackPalette;
@@ -0,0 +1,129 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "imagecolorscache.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QVarLengthArray>
+
+#include "imagecolorscache_logging.h"
+
+#include <cstring>
+
+static constexpr qsizetype s_defaultMaxEntries = 512;
+static constexpr int s_hashedSize = 128;
+
+QCache<QByteArray, ImageData> &ImageColorsCache::cache()
+{
+    static QCache<QByteArray, ImageData> cache([] {
+        bool ok = false;
+        const int size = qEnvironmentVariableIntValue("KIRIGAMI_IMAGECOLORS_CACHE_SIZE", &ok);
+        return ok ? qsizetype(std::max(0, size)) : s_defaultMaxEntries;
+    }());
+    return cache;
+}
+
+QByteArray ImageColorsCache::keyForImage(const QImage &image, ImageColors::Quantizer quantizer)
+{
+    if (image.isNull()) {
+        return {};
+    }
+
+    // Only hash the visible part of each line; padding bytes are undefined.
+    // Larger images are hashed from a grid of s_hashedSize x s_hashedSize
+    // pixels, so that keying them costs no more than keying a grab.
+    const qsizetype lineLength = (qsizetype(image.width()) * image.depth() + 7) / 8;
+    const int bytesPerPixel = image.depth() / 8;
+    const int rows = std::min(image.height(), s_hashedSize);
+    const int columns = bytesPerPixel > 0 ? std::min(image.width(), s_hashedSize) : image.width();
+
+    size_t hash = qHashMulti(0, image.width(), image.height(), int(image.format()));
+    QVarLengthArray<uchar, s_hashedSize * 8> pixels(qsizetype(columns) * bytesPerPixel);
+    for (int row = 0; row < rows; ++row) {
+        const uchar *line = image.constScanLine(int(qint64(row) * image.height() / rows));
+        if (columns == image.width()) {
+            hash = qHashBits(line, lineLength, hash);
+            continue;
+        }
+        for (int column = 0; column < columns; ++column) {
+            const qsizetype x = qint64(column) * image.width() / columns;
+            std::memcpy(pixels.data() + column * bytesPerPixel, line + x * bytesPerPixel, bytesPerPixel);
+        }
+        hash = qHashBits(pixels.constData(), pixels.size(), hash);
+    }
+
+    return QByteArrayLiteral("image:") + QByteArray::number(quint64(hash), 16) + '#' + QByteArray::number(int(quantizer));
+}
+
+QByteArray ImageColorsCache::keyForFile(const QString &path, ImageColors::Quantizer quantizer)
+{
+    const QFileInfo info(path);
+    if (!info.isFile()) {
+        return {};
+    }
+
+    return QByteArrayLiteral("file:") + info.absoluteFilePath().toUtf8() + '@' + QByteArray::number(info.lastModified().toMSecsSinceEpoch()) + '#'
+        + QByteArray::number(int(quantizer));
+}
+
+std::optional<ImageData> ImageColorsCache::find(const QByteArray &key)
+{
+    if (key.isEmpty()) {
+        return std::nullopt;
+    }
+
+    QMutexLocker locker(&s_mutex);
+    if (const ImageData *imageData = cache().object(key)) {
+        ++s_hits;
+        return *imageData;
+    }
+    ++s_misses;
+    return std::nullopt;
+}
+
+void ImageColorsCache::insert(const QByteArray &key, const ImageData &imageData)
+{
+    if (key.isEmpty()) {
+        return;
+    }
+
+    // The samples and per-cluster colors are only needed while generating
+    // the palette, they make up nearly all of the memory of an ImageData.
+    auto entry = new ImageData(imageData);
+    entry->m_samples = {};
+    for (auto &cluster : entry->m_clusters) {
+        cluster.colors = {};
+    }
+
+    QMutexLocker locker(&s_mutex);
+    cache().insert(key, entry);
+    const qint64 lookups = s_hits + s_misses;
+    qCDebug(KirigamiImageColorsCache).nospace() << cache().size() << "/" << cache().maxCost() << " palettes, " //
+                                                << s_hits << " hits, " << s_misses << " misses (" //
+                                                << (lookups > 0 ? s_hits * 100 / lookups : 0) << "% hit rate)";
+}
+
+void ImageColorsCache::setMaxEntries(qsizetype maxEntries)
+{
+    QMutexLocker locker(&s_mutex);
+    cache().setMaxCost(maxEntries);
+}
+
+void ImageColorsCache::clear()
+{
+    QMutexLocker locker(&s_mutex);
+    cache().clear();
+    s_hits = 0;
+    s_misses = 0;
+}
+
+ImageColorsCache::Statistics ImageColorsCache::statistics()
+{
+    QMutexLocker locker(&s_mutex);
+    return Statistics{s_hits, s_misses, cache().size(), cache().maxCost()};
+}
@@ -0,0 +1,86 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+
+#include <optional>
+
+#include "imagecolors.h"
+
+/*!
+ * \internal
+ *
+ * Process-wide LRU cache of generated palettes, shared by all ImageColors
+ * instances so that the same cover art shown by many delegates, or by
+ * delegates recreated while scrolling, is only analyzed once.
+ *
+ * Entries hold the output of ImageColors::generatePalette() before it is
+ * adjusted to the theme of a specific instance, without the raw samples.
+ *
+ * The cache only lives in memory, palettes are not persisted across
+ * restarts.
+ *
+ * The size of the cache, in entries, can be set with the
+ * KIRIGAMI_IMAGECOLORS_CACHE_SIZE environment variable; 0 disables it. Its
+ * hit rate is logged to the kf.kirigami.imagecolors.cache category whenever
+ * a palette is added, e.g. with
+ * QT_LOGGING_RULES="kf.kirigami.imagecolors.cache.debug=true".
+ */
+class ImageColorsCache
+{
+public:
+    struct Statistics {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qsizetype entries = 0;
+        qsizetype maxEntries = 0;
+    };
+
+    /*!
+     * Returns a key identifying the pixel contents of \a image, or an empty
+     * key if it is null. Only up to 128x128 evenly spaced pixels are hashed,
+     * so that the key of a large image is as cheap as that of a grab.
+     */
+    static QByteArray keyForImage(const QImage &image, ImageColors::Quantizer quantizer);
+
+    /*!
+     * Returns a key identifying the file at \a path as of its last modification,
+     * or an empty key if it does not exist.
+     */
+    static QByteArray keyForFile(const QString &path, ImageColors::Quantizer quantizer);
+
+    /*!
+     * Returns the palette stored for \a key, counting a hit or a miss.
+     * An empty key is never found and is not counted.
+     */
+    static std::optional<ImageData> find(const QByteArray &key);
+    /*!
+     * Stores \a imageData for \a key, without its raw samples.
+     */
+    static void insert(const QByteArray &key, const ImageData &imageData);
+
+    /*!
+     * Limits the cache to \a maxEntries palettes, evicting the least recently
+     * used ones; 0 disables the cache.
+     */
+    static void setMaxEntries(qsizetype maxEntries);
+    /*!
+     * Removes all entries and resets the statistics.
+     */
+    static void clear();
+    static Statistics statistics();
+
+private:
+    static QCache<QByteArray, ImageData> &cache();
+
+    inline static QMutex s_mutex;
+    inline static qint64 s_hits = 0;
+    inline static qint64 s_misses = 0;
+};
@@ -0,0 +1,379 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "imagecolorsproxymodel.h"
+
+#include <QPromise>
+#include <QUrl>
+#include <QtConcurrentTask>
+
+#include "imagecolorscache.h"
+#include "platform/platformtheme.h"
+
+// Number of images analyzed by a single worker job
+static constexpr qsizetype s_batchSize = 16;
+
+// Enough for the rows of a few screens of delegates
+static constexpr qsizetype s_maxCachedKeys = 1024;
+static constexpr qsizetype s_maxCachedPalettes = 256;
+
+ImageColorsProxyModel::ImageColorsProxyModel(QObject *parent)
+    : QIdentityProxyModel(parent)
+    , m_keys(s_maxCachedKeys)
+    , m_palettes(s_maxCachedPalettes)
+{
+    auto platformTheme = static_cast<Kirigami::Platform::PlatformTheme *>(qmlAttachedPropertiesObject<Kirigami::Platform::PlatformTheme>(this, true));
+    connect(platformTheme, &Kirigami::Platform::PlatformTheme::colorsChanged, this, [this]() {
+        // Palettes are adjusted to the theme, redo that from the cache
+        m_palettes.clear();
+        if (rowCount() > 0) {
+            Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1), paletteRoles());
+        }
+    });
+
+    connect(this, &QAbstractItemModel::modelReset, this, [this]() {
+        m_keys.clear();
+        updateRoles();
+    });
+    connect(this, &QAbstractItemModel::layoutChanged, this, &ImageColorsProxyModel::updateRoles);
+    // Moved rows keep their key, the persistent indexes follow them
+    connect(this, &QAbstractItemModel::rowsRemoved, this, [this]() {
+        const auto indexes = m_keys.keys();
+        for (const auto &index : indexes) {
+            if (!index.isValid()) {
+                m_keys.remove(index);
+            }
+        }
+    });
+    // Models like ListModel only know their roles once they have rows
+    connect(this, &QAbstractItemModel::rowsInserted, this, [this]() {
+        if (m_imageRoleId < 0) {
+            updateRoles();
+        }
+    });
+}
+
+ImageColorsProxyModel::~ImageColorsProxyModel()
+{
+    reset();
+}
+
+QString ImageColorsProxyModel::imageRole() const
+{
+    return m_imageRole;
+}
+
+void ImageColorsProxyModel::setImageRole(const QString &imageRole)
+{
+    if (m_imageRole == imageRole) {
+        return;
+    }
+
+    beginResetModel();
+    m_imageRole = imageRole;
+    reset();
+    endResetModel();
+    Q_EMIT imageRoleChanged();
+}
+
+ImageColors::Quantizer ImageColorsProxyModel::quantizer() const
+{
+    return m_quantizer;
+}
+
+void ImageColorsProxyModel::setQuantizer(ImageColors::Quantizer quantizer)
+{
+    if (m_quantizer == quantizer) {
+        return;
+    }
+
+    beginResetModel();
+    m_quantizer = quantizer;
+    reset();
+    endResetModel();
+    Q_EMIT quantizerChanged();
+}
+
+void ImageColorsProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    if (this->sourceModel()) {
+        disconnect(this->sourceModel(), nullptr, this, nullptr);
+    }
+
+    reset();
+
+    // Connected first, so that the keys are dropped before the forwarded
+    // dataChanged makes views read the rows again
+    if (sourceModel) {
+        connect(sourceModel, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles) {
+            if (!roles.isEmpty() && !roles.contains(m_imageRoleId)) {
+                return;
+            }
+            invalidateKeys(topLeft.row(), bottomRight.row());
+            // An empty list of roles already covers the palette roles
+            if (!roles.isEmpty()) {
+                Q_EMIT dataChanged(mapFromSource(topLeft), mapFromSource(bottomRight), paletteRoles());
+            }
+        });
+    }
+
+    // Resets the model, which updates the roles
+    QIdentityProxyModel::setSourceModel(sourceModel);
+}
+
+void ImageColorsProxyModel::reset()
+{
+    for (auto job : std::as_const(m_jobs)) {
+        job->disconnect(this);
+        job->cancel();
+        job->deleteLater();
+    }
+    m_jobs.clear();
+    m_keys.clear();
+    m_palettes.clear();
+    m_waiting.clear();
+    m_queue.clear();
+}
+
+void ImageColorsProxyModel::updateRoles()
+{
+    m_imageRoleId = -1;
+    m_firstRole = Qt::UserRole;
+
+    if (!sourceModel()) {
+        return;
+    }
+
+    const auto sourceRoles = sourceModel()->roleNames();
+    for (auto it = sourceRoles.cbegin(); it != sourceRoles.cend(); ++it) {
+        if (QString::fromUtf8(it.value()) == m_imageRole) {
+            m_imageRoleId = it.key();
+        }
+        m_firstRole = std::max(m_firstRole, it.key() + 1);
+    }
+}
+
+QList<int> ImageColorsProxyModel::paletteRoles() const
+{
+    QList<int> roles;
+    for (int role = DominantRole; role <= PaletteBrightnessRole; ++role) {
+        roles.append(m_firstRole + role);
+    }
+    return roles;
+}
+
+QHash<int, QByteArray> ImageColorsProxyModel::roleNames() const
+{
+    auto roles = QIdentityProxyModel::roleNames();
+    roles.insert(m_firstRole + DominantRole, QByteArrayLiteral("dominant"));
+    roles.insert(m_firstRole + DominantContrastRole, QByteArrayLiteral("dominantContrast"));
+    roles.insert(m_firstRole + AverageRole, QByteArrayLiteral("average"));
+    roles.insert(m_firstRole + HighlightRole, QByteArrayLiteral("highlight"));
+    roles.insert(m_firstRole + ClosestToWhiteRole, QByteArrayLiteral("closestToWhite"));
+    roles.insert(m_firstRole + ClosestToBlackRole, QByteArrayLiteral("closestToBlack"));
+    roles.insert(m_firstRole + PaletteRole, QByteArrayLiteral("palette"));
+    roles.insert(m_firstRole + PaletteBrightnessRole, QByteArrayLiteral("paletteBrightness"));
+    return roles;
+}
+
+QByteArray ImageColorsProxyModel::keyForSource(const QVariant &source) const
+{
+    if (source.metaType() == QMetaType::fromType<QImage>()) {
+        return ImageColorsCache::keyForImage(source.value<QImage>(), m_quantizer);
+    }
+    if (source.metaType() == QMetaType::fromType<QUrl>()) {
+        const QUrl url = source.toUrl();
+        return url.isLocalFile() ? ImageColorsCache::keyForFile(url.toLocalFile(), m_quantizer) : QByteArray();
+    }
+    if (source.canConvert<QString>()) {
+        const QString sourceString = source.toString();
+        const QUrl url(sourceString);
+        return ImageColorsCache::keyForFile(url.isLocalFile() ? url.toLocalFile() : sourceString, m_quantizer);
+    }
+    return {};
+}
+
+void ImageColorsProxyModel::invalidateKeys(int first, int last)
+{
+    const auto indexes = m_keys.keys();
+    for (const auto &index : indexes) {
+        if (!index.isValid() || (index.row() >= first && index.row() <= last)) {
+            m_keys.remove(index);
+        }
+    }
+}
+
+QVariant ImageColorsProxyModel::data(const QModelIndex &index, int role) const
+{
+    if (role < m_firstRole || role > m_firstRole + PaletteBrightnessRole) {
+        return QIdentityProxyModel::data(index, role);
+    }
+
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid) || m_imageRoleId < 0) {
+        return {};
+    }
+
+    // Computing the key means hashing the image or a stat() of the file,
+    // only do that once per row rather than once per role and delegate.
+    const QPersistentModelIndex rowIndex(index.siblingAtColumn(0));
+    QByteArray key;
+    if (const QByteArray *cachedKey = m_keys.object(rowIndex)) {
+        key = *cachedKey;
+    } else {
+        key = keyForSource(mapToSource(index).data(m_imageRoleId));
+        m_keys.insert(rowIndex, new QByteArray(key));
+    }
+    if (key.isEmpty()) {
+        return {};
+    }
+
+    const ImageData *imageData = m_palettes.object(key);
+    if (!imageData) {
+        if (m_waiting.contains(key)) {
+            request(key, mapToSource(index).data(m_imageRoleId), index);
+            return {};
+        } else if (auto cachedData = ImageColorsCache::find(key)) {
+            auto entry = new ImageData(std::move(*cachedData));
+            postProcess(*entry);
+            m_palettes.insert(key, entry);
+            imageData = entry;
+        } else {
+            request(key, mapToSource(index).data(m_imageRoleId), index);
+            return {};
+        }
+    }
+
+    if (imageData->m_palette.isEmpty()) {
+        return {};
+    }
+
+    switch (role - m_firstRole) {
+    case DominantRole:
+        return imageData->m_dominant;
+    case DominantContrastRole:
+        return imageData->m_dominantContrast;
+    case AverageRole:
+        return imageData->m_average;
+    case HighlightRole:
+        return imageData->m_highlight;
+    case ClosestToWhiteRole:
+        return imageData->m_closestToWhite;
+    case ClosestToBlackRole:
+        return imageData->m_closestToBlack;
+    case PaletteRole:
+        return QVariant::fromValue(imageData->m_palette);
+    case PaletteBrightnessRole:
+        return QVariant::fromValue(qGray(imageData->m_dominant.rgb()) < 128 ? ColorUtils::Dark : ColorUtils::Light);
+    }
+
+    return {};
+}
+
+void ImageColorsProxyModel::request(const QByteArray &key, const QVariant &source, const QModelIndex &index) const
+{
+    const bool queued = m_waiting.contains(key);
+    auto &waiting = m_waiting[key];
+    if (!waiting.contains(index)) {
+        waiting.append(QPersistentModelIndex(index));
+    }
+    if (queued) {
+        return; // Already queued or being processed
+    }
+
+    m_queue.append(Request{key, source});
+    // Collect all requests made while the view populates its delegates
+    if (!m_processScheduled) {
+        m_processScheduled = true;
+        QMetaObject::invokeMethod(const_cast<ImageColorsProxyModel *>(this), &ImageColorsProxyModel::processRequests, Qt::QueuedConnection);
+    }
+}
+
+void ImageColorsProxyModel::processRequests()
+{
+    m_processScheduled = false;
+
+    auto generate = [](QPromise<QList<Result>> &promise, const QList<Request> &batch, ImageColors::Quantizer quantizer) {
+        QList<Result> results;
+        results.reserve(batch.size());
+        for (const auto &request : batch) {
+            if (promise.isCanceled()) {
+                return;
+            }
+            QImage image;
+            if (request.source.metaType() == QMetaType::fromType<QImage>()) {
+                image = request.source.value<QImage>();
+            } else {
+                const QUrl url = request.source.toUrl();
+                image = ImageColors::loadImage(url.isLocalFile() ? url.toLocalFile() : request.source.toString());
+            }
+            ImageData imageData = ImageColors::generatePalette(image, quantizer, [&promise]() {
+                return promise.isCanceled();
+            });
+            results.append(Result{request.key, std::move(imageData)});
+        }
+        if (!promise.isCanceled()) {
+            promise.addResult(std::move(results));
+        }
+    };
+
+    while (!m_queue.isEmpty()) {
+        const QList<Request> batch = m_queue.first(std::min(s_batchSize, m_queue.size()));
+        m_queue.remove(0, batch.size());
+
+        QFuture<QList<Result>> future =
+            QtConcurrent::task(generate).withArguments(batch, m_quantizer).onThreadPool(*ImageColors::threadPool()).spawn();
+        auto watcher = new QFutureWatcher<QList<Result>>(this);
+        connect(watcher, &QFutureWatcher<QList<Result>>::finished, this, [this, watcher]() {
+            m_jobs.removeOne(watcher);
+            watcher->deleteLater();
+            if (watcher->future().resultCount() > 0) {
+                handleResults(watcher->future().result());
+            }
+        });
+        watcher->setFuture(future);
+        m_jobs.append(watcher);
+    }
+}
+
+void ImageColorsProxyModel::handleResults(const QList<Result> &results)
+{
+    QList<int> rows;
+    for (const auto &result : results) {
+        ImageColorsCache::insert(result.key, result.imageData);
+        auto imageData = new ImageData(result.imageData);
+        postProcess(*imageData);
+        m_palettes.insert(result.key, imageData);
+
+        for (const auto &index : m_waiting.take(result.key)) {
+            if (index.isValid()) {
+                rows.append(index.row());
+            }
+        }
+    }
+
+    // One signal per contiguous range of rows rather than one per row
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    const QList<int> roles = paletteRoles();
+    const int lastColumn = columnCount() - 1;
+    for (qsizetype i = 0; i < rows.size();) {
+        qsizetype j = i;
+        while (j + 1 < rows.size() && rows[j + 1] == rows[j] + 1) {
+            ++j;
+        }
+        Q_EMIT dataChanged(index(rows[i], 0), index(rows[j], lastColumn), roles);
+        i = j + 1;
+    }
+}
+
+void ImageColorsProxyModel::postProcess(ImageData &imageData) const
+{
+    auto platformTheme = static_cast<Kirigami::Platform::PlatformTheme *>(qmlAttachedPropertiesObject<Kirigami::Platform::PlatformTheme>(this, true));
+    ImageColors::postProcess(imageData, platformTheme->backgroundColor(), platformTheme->textColor());
+}
+
+#include "moc_imagecolorsproxymodel.cpp"
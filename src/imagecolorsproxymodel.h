@@ -0,0 +1,147 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QCache>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QIdentityProxyModel>
+#include <QPersistentModelIndex>
+#include <QQmlEngine>
+
+#include "imagecolors.h"
+
+/*!
+ * \qmltype ImageColorsProxyModel
+ * \inqmlmodule org.kde.kirigami
+ *
+ * \brief Adds the colors extracted by ImageColors to every row of a model.
+ *
+ * Rows of the source model are passed through unchanged, with additional
+ * roles holding the palette of the image in imageRole. Palettes are computed
+ * in batches on worker threads, shared with ImageColors through the palette
+ * cache, and delivered through coalesced dataChanged signals. This avoids one
+ * ImageColors object per delegate in large views.
+ *
+ * The image role may hold a local file path or URL, or an image. Files are
+ * identified by their path and modification time when their row is first
+ * read; the palette of a row is only recomputed once its image role changes.
+ *
+ * Until a palette is available the palette roles are undefined.
+ *
+ * \code
+ * ListView {
+ *     model: Kirigami.ImageColorsProxyModel {
+ *         sourceModel: albumModel
+ *         imageRole: "cover"
+ *     }
+ *     delegate: ItemDelegate {
+ *         required property color dominant
+ *         background: Rectangle { color: parent.dominant }
+ *     }
+ * }
+ * \endcode
+ *
+ * \sa ImageColors
+ */
+class ImageColorsProxyModel : public QIdentityProxyModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    /*!
+     * \qmlproperty string ImageColorsProxyModel::imageRole
+     *
+     * The name of the source model role holding the image of each row.
+     */
+    Q_PROPERTY(QString imageRole READ imageRole WRITE setImageRole NOTIFY imageRoleChanged FINAL)
+
+    /*!
+     * \qmlproperty enumeration ImageColorsProxyModel::quantizer
+     *
+     * The algorithm used to extract the palettes, see ImageColors::quantizer.
+     */
+    Q_PROPERTY(ImageColors::Quantizer quantizer READ quantizer WRITE setQuantizer NOTIFY quantizerChanged FINAL)
+
+public:
+    /*!
+     * \value DominantRole The dominant color, see ImageColors::dominant
+     * \value DominantContrastRole See ImageColors::dominantContrast
+     * \value AverageRole The average color, see ImageColors::average
+     * \value HighlightRole The accent color, see ImageColors::highlight
+     * \value ClosestToWhiteRole See ImageColors::closestToWhite
+     * \value ClosestToBlackRole See ImageColors::closestToBlack
+     * \value PaletteRole The list of swatches, see ImageColors::palette
+     * \value PaletteBrightnessRole See ImageColors::paletteBrightness
+     *
+     * The actual role values start after the highest role of the source model.
+     */
+    enum Role {
+        DominantRole,
+        DominantContrastRole,
+        AverageRole,
+        HighlightRole,
+        ClosestToWhiteRole,
+        ClosestToBlackRole,
+        PaletteRole,
+        PaletteBrightnessRole,
+    };
+    Q_ENUM(Role)
+
+    explicit ImageColorsProxyModel(QObject *parent = nullptr);
+    ~ImageColorsProxyModel() override;
+
+    QString imageRole() const;
+    void setImageRole(const QString &imageRole);
+
+    ImageColors::Quantizer quantizer() const;
+    void setQuantizer(ImageColors::Quantizer quantizer);
+
+    void setSourceModel(QAbstractItemModel *sourceModel) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+Q_SIGNALS:
+    void imageRoleChanged();
+    void quantizerChanged();
+
+private:
+    struct Request {
+        QByteArray key;
+        QVariant source;
+    };
+    struct Result {
+        QByteArray key;
+        ImageData imageData;
+    };
+
+    QList<int> paletteRoles() const;
+    QByteArray keyForSource(const QVariant &source) const;
+    void invalidateKeys(int first, int last);
+    void request(const QByteArray &key, const QVariant &source, const QModelIndex &index) const;
+    void processRequests();
+    void handleResults(const QList<Result> &results);
+    void postProcess(ImageData &imageData) const;
+    void reset();
+    void updateRoles();
+
+    QString m_imageRole;
+    int m_imageRoleId = -1;
+    int m_firstRole = Qt::UserRole;
+    ImageColors::Quantizer m_quantizer = ImageColors::KMeans;
+
+    // Source key of each row, dropped when its image changes
+    mutable QCache<QPersistentModelIndex, QByteArray> m_keys;
+    // Palettes adjusted to the theme, by source key. Evicted ones are
+    // adjusted again from the palette cache when needed.
+    mutable QCache<QByteArray, ImageData> m_palettes;
+    // Rows waiting for a palette, by source key
+    mutable QHash<QByteArray, QList<QPersistentModelIndex>> m_waiting;
+    mutable QList<Request> m_queue;
+    mutable bool m_processScheduled = false;
+    QList<QFutureWatcher<QList<Result>> *> m_jobs;
+};
@@ -6,11 +6,13 @@
  */
 
 #include "basictheme_p.h"
+#include "platformpluginfactory.h"
 #include "styleselector.h"
+#include "systemfonts_p.h"
 
 #include <QFile>
-#include <QFontDatabase>
 #include <QGuiApplication>
+#include <QQmlEngine>
 
 #include "kirigamiplatform_logging.h"
 
@@ -22,9 +24,9 @@ namespace Platform
 BasicThemeDefinition::BasicThemeDefinition(QObject *parent)
     : QObject(parent)
 {
-    defaultFont = qGuiApp->font();
+    defaultFont = SystemFonts::defaultFont();
 
-    smallFont = QFontDatabase::systemFont(QFontDatabase::SmallestReadableFont);
+    smallFont = SystemFonts::smallFont();
 }
 
 void BasicThemeDefinition::syncToQml(PlatformTheme *object)
@@ -50,16 +52,22 @@ BasicThemeDefinition &BasicThemeInstance::themeDefinition(QQmlEngine *engine)
         qCWarning(KirigamiPlatform) << "No QML engine found, using default Basic theme.";
         m_themeDefinition = std::make_unique<BasicThemeDefinition>();
     } else {
-        auto themeUrl = StyleSelector::componentUrlForModule(QStringLiteral("controls"), QStringLiteral("Theme.qml"));
+        auto themeUrl = this->themeUrl();
 
         if (themeUrl.isValid()) {
-            QQmlComponent component(engine);
-            component.loadUrl(themeUrl);
+            // Use the preloaded component if possible. A synchronous load of a
+            // component that is still being compiled waits for it to finish.
+            std::optional<QQmlComponent> localComponent;
+            QQmlComponent *component = m_preloadComponent;
+            if (!component || component->engine() != engine || component->isLoading()) {
+                component = &localComponent.emplace(engine);
+                component->loadUrl(themeUrl);
+            }
 
-            if (auto themeDefinition = qobject_cast<BasicThemeDefinition *>(component.create())) {
+            if (auto themeDefinition = qobject_cast<BasicThemeDefinition *>(component->create())) {
                 m_themeDefinition.reset(themeDefinition);
             } else {
-                const auto errors = component.errors();
+                const auto errors = component->errors();
                 for (auto error : errors) {
                     qCWarning(KirigamiPlatform) << error.toString();
                 }
@@ -73,18 +81,151 @@ BasicThemeDefinition &BasicThemeInstance::themeDefinition(QQmlEngine *engine)
         }
     }
 
+    if (m_preloadComponent) {
+        m_preloadComponent->deleteLater();
+    }
+
     connect(m_themeDefinition.get(), &BasicThemeDefinition::changed, this, &BasicThemeInstance::onDefinitionChanged);
 
+    updateColorTables();
+
     return *m_themeDefinition;
 }
 
+void BasicThemeInstance::preload(QQmlEngine *engine)
+{
+    if (!engine || m_themeDefinition || m_preloadComponent) {
+        return;
+    }
+
+    const auto themeUrl = this->themeUrl();
+    if (themeUrl.isValid()) {
+        m_preloadComponent = new QQmlComponent(engine, themeUrl, QQmlComponent::Asynchronous, engine);
+    }
+}
+
+QUrl BasicThemeInstance::themeUrl()
+{
+    if (!m_themeUrl) {
+        m_themeUrl = StyleSelector::componentUrlForModule(QStringLiteral("controls"), QStringLiteral("Theme.qml"));
+    }
+    return *m_themeUrl;
+}
+
+const BasicThemeColors &BasicThemeInstance::colors(QQmlEngine *engine, PlatformTheme::ColorSet colorSet, PlatformTheme::ColorGroup colorGroup)
+{
+    // Makes sure the tables are filled in
+    themeDefinition(engine);
+
+    if (colorSet < 0 || colorSet >= PlatformTheme::ColorSetCount) {
+        colorSet = PlatformTheme::Window;
+    }
+    if (colorGroup < 0 || colorGroup >= s_colorGroupCount) {
+        colorGroup = PlatformTheme::Active;
+    }
+
+    return m_colorTables[colorSet * s_colorGroupCount + colorGroup];
+}
+
 void BasicThemeInstance::onDefinitionChanged()
 {
+    updateColorTables();
+
     for (auto watcher : std::as_const(watchers)) {
         watcher->sync();
     }
 }
 
+static QColor tint(const QColor &color, PlatformTheme::ColorGroup colorGroup)
+{
+    switch (colorGroup) {
+    case PlatformTheme::Inactive:
+        return QColor::fromHsvF(color.hueF(), color.saturationF() * 0.5, color.valueF());
+    case PlatformTheme::Disabled:
+        return QColor::fromHsvF(color.hueF(), color.saturationF() * 0.5, color.valueF() * 0.8);
+    default:
+        return color;
+    }
+}
+
+void BasicThemeInstance::updateColorTables()
+{
+    const auto &definition = *m_themeDefinition;
+
+    for (int set = 0; set < PlatformTheme::ColorSetCount; ++set) {
+        for (int group = 0; group < s_colorGroupCount; ++group) {
+            const auto colorGroup = PlatformTheme::ColorGroup(group);
+            auto &colors = m_colorTables[set * s_colorGroupCount + group];
+
+            auto setColors = [&](const QColor &text, const QColor &background, const QColor &alternateBackground, const QColor &hover, const QColor &focus) {
+                colors.textColor = tint(text, colorGroup);
+                colors.backgroundColor = tint(background, colorGroup);
+                colors.alternateBackgroundColor = tint(alternateBackground, colorGroup);
+                colors.hoverColor = tint(hover, colorGroup);
+                colors.focusColor = tint(focus, colorGroup);
+            };
+
+            switch (set) {
+            case PlatformTheme::Button:
+                setColors(definition.buttonTextColor,
+                          definition.buttonBackgroundColor,
+                          definition.buttonAlternateBackgroundColor,
+                          definition.buttonHoverColor,
+                          definition.buttonFocusColor);
+                break;
+            case PlatformTheme::View:
+                setColors(definition.viewTextColor,
+                          definition.viewBackgroundColor,
+                          definition.viewAlternateBackgroundColor,
+                          definition.viewHoverColor,
+                          definition.viewFocusColor);
+                break;
+            case PlatformTheme::Selection:
+                setColors(definition.selectionTextColor,
+                          definition.selectionBackgroundColor,
+                          definition.selectionAlternateBackgroundColor,
+                          definition.selectionHoverColor,
+                          definition.selectionFocusColor);
+                break;
+            case PlatformTheme::Tooltip:
+                setColors(definition.tooltipTextColor,
+                          definition.tooltipBackgroundColor,
+                          definition.tooltipAlternateBackgroundColor,
+                          definition.tooltipHoverColor,
+                          definition.tooltipFocusColor);
+                break;
+            case PlatformTheme::Complementary:
+                setColors(definition.complementaryTextColor,
+                          definition.complementaryBackgroundColor,
+                          definition.complementaryAlternateBackgroundColor,
+                          definition.complementaryHoverColor,
+                          definition.complementaryFocusColor);
+                break;
+            case PlatformTheme::Window:
+            default:
+                setColors(definition.textColor, definition.backgroundColor, definition.alternateBackgroundColor, definition.hoverColor, definition.focusColor);
+                break;
+            }
+
+            colors.disabledTextColor = tint(definition.disabledTextColor, colorGroup);
+            colors.highlightColor = tint(definition.highlightColor, colorGroup);
+            colors.highlightedTextColor = tint(definition.highlightedTextColor, colorGroup);
+            colors.activeTextColor = tint(definition.activeTextColor, colorGroup);
+            colors.activeBackgroundColor = tint(definition.activeBackgroundColor, colorGroup);
+            colors.linkColor = tint(definition.linkColor, colorGroup);
+            colors.linkBackgroundColor = tint(definition.linkBackgroundColor, colorGroup);
+            colors.visitedLinkColor = tint(definition.visitedLinkColor, colorGroup);
+            colors.visitedLinkBackgroundColor = tint(definition.visitedLinkBackgroundColor, colorGroup);
+            colors.negativeTextColor = tint(definition.negativeTextColor, colorGroup);
+            colors.negativeBackgroundColor = tint(definition.negativeBackgroundColor, colorGroup);
+            colors.neutralTextColor = tint(definition.neutralTextColor, colorGroup);
+            colors.neutralBackgroundColor = tint(definition.neutralBackgroundColor, colorGroup);
+            colors.positiveTextColor = tint(definition.positiveTextColor, colorGroup);
+            colors.positiveBackgroundColor = tint(definition.positiveBackgroundColor, colorGroup);
+        }
+    }
+}
+
 Q_GLOBAL_STATIC(BasicThemeInstance, basicThemeInstance)
 
 BasicTheme::BasicTheme(QObject *parent)
@@ -100,74 +241,73 @@ BasicTheme::~BasicTheme()
     basicThemeInstance()->watchers.removeOne(this);
 }
 
+void BasicTheme::preloadDefinition(QQmlEngine *engine)
+{
+    if (!engine) {
+        return;
+    }
+
+    // Resolving the style's Theme.qml checks several paths on disk, don't
+    // make importing the module wait for it. Dropped with the engine.
+    QMetaObject::invokeMethod(
+        engine,
+        [engine]() {
+            // Themes then come from the platform plugin instead, the same
+            // way PlatformTheme::qmlAttachedProperties() picks it.
+            const QString pluginName = engine->property("_kirigamiTheme").toString();
+            if (PlatformPluginFactory::findPlugin(pluginName) || (!pluginName.isEmpty() && PlatformPluginFactory::findPlugin())) {
+                return;
+            }
+
+            basicThemeInstance()->preload(engine);
+        },
+        Qt::QueuedConnection);
+}
+
 void BasicTheme::sync()
 {
+    // Besides batching our own signals, the tracker stages all of the changes
+    // below so the palette is rebuilt and inheriting themes are notified once.
     PlatformThemeChangeTracker tracker{this};
 
-    auto &definition = basicThemeInstance()->themeDefinition(qmlEngine(parent()));
-
-    switch (colorSet()) {
-    case BasicTheme::Button:
-        setTextColor(tint(definition.buttonTextColor));
-        setBackgroundColor(tint(definition.buttonBackgroundColor));
-        setAlternateBackgroundColor(tint(definition.buttonAlternateBackgroundColor));
-        setHoverColor(tint(definition.buttonHoverColor));
-        setFocusColor(tint(definition.buttonFocusColor));
-        break;
-    case BasicTheme::View:
-        setTextColor(tint(definition.viewTextColor));
-        setBackgroundColor(tint(definition.viewBackgroundColor));
-        setAlternateBackgroundColor(tint(definition.viewAlternateBackgroundColor));
-        setHoverColor(tint(definition.viewHoverColor));
-        setFocusColor(tint(definition.viewFocusColor));
-        break;
-    case BasicTheme::Selection:
-        setTextColor(tint(definition.selectionTextColor));
-        setBackgroundColor(tint(definition.selectionBackgroundColor));
-        setAlternateBackgroundColor(tint(definition.selectionAlternateBackgroundColor));
-        setHoverColor(tint(definition.selectionHoverColor));
-        setFocusColor(tint(definition.selectionFocusColor));
-        break;
-    case BasicTheme::Tooltip:
-        setTextColor(tint(definition.tooltipTextColor));
-        setBackgroundColor(tint(definition.tooltipBackgroundColor));
-        setAlternateBackgroundColor(tint(definition.tooltipAlternateBackgroundColor));
-        setHoverColor(tint(definition.tooltipHoverColor));
-        setFocusColor(tint(definition.tooltipFocusColor));
-        break;
-    case BasicTheme::Complementary:
-        setTextColor(tint(definition.complementaryTextColor));
-        setBackgroundColor(tint(definition.complementaryBackgroundColor));
-        setAlternateBackgroundColor(tint(definition.complementaryAlternateBackgroundColor));
-        setHoverColor(tint(definition.complementaryHoverColor));
-        setFocusColor(tint(definition.complementaryFocusColor));
-        break;
-    case BasicTheme::Window:
-    default:
-        setTextColor(tint(definition.textColor));
-        setBackgroundColor(tint(definition.backgroundColor));
-        setAlternateBackgroundColor(tint(definition.alternateBackgroundColor));
-        setHoverColor(tint(definition.hoverColor));
-        setFocusColor(tint(definition.focusColor));
-        break;
-    }
-
-    setDisabledTextColor(tint(definition.disabledTextColor));
-    setHighlightColor(tint(definition.highlightColor));
-    setHighlightedTextColor(tint(definition.highlightedTextColor));
-    setActiveTextColor(tint(definition.activeTextColor));
-    setActiveBackgroundColor(tint(definition.activeBackgroundColor));
-    setLinkColor(tint(definition.linkColor));
-    setLinkBackgroundColor(tint(definition.linkBackgroundColor));
-    setVisitedLinkColor(tint(definition.visitedLinkColor));
-    setVisitedLinkBackgroundColor(tint(definition.visitedLinkBackgroundColor));
-    setNegativeTextColor(tint(definition.negativeTextColor));
-    setNegativeBackgroundColor(tint(definition.negativeBackgroundColor));
-    setNeutralTextColor(tint(definition.neutralTextColor));
-    setNeutralBackgroundColor(tint(definition.neutralBackgroundColor));
-    setPositiveTextColor(tint(definition.positiveTextColor));
-    setPositiveBackgroundColor(tint(definition.positiveBackgroundColor));
+    // Disabled items are tinted like the Disabled color group
+    auto colorGroup = this->colorGroup();
+    if (QQuickItem *item = qobject_cast<QQuickItem *>(parent()); item && !item->isEnabled()) {
+        colorGroup = PlatformTheme::Disabled;
+    }
 
+    // The precomputed colors are copied into the data of the theme rather
+    // than referenced: PlatformThemeData holds the values for every platform
+    // plugin, and its setters are what rebuild the QPalette and send the
+    // change events. Only the tinting is shared. Themes with the same
+    // colorSet and colorGroup share their data, so the copies made while they
+    // all sync after a definition change are merged again as each one is done.
+    auto engine = qmlEngine(parent());
+    const auto &colors = basicThemeInstance()->colors(engine, colorSet(), colorGroup);
+
+    setTextColor(colors.textColor);
+    setBackgroundColor(colors.backgroundColor);
+    setAlternateBackgroundColor(colors.alternateBackgroundColor);
+    setHoverColor(colors.hoverColor);
+    setFocusColor(colors.focusColor);
+
+    setDisabledTextColor(colors.disabledTextColor);
+    setHighlightColor(colors.highlightColor);
+    setHighlightedTextColor(colors.highlightedTextColor);
+    setActiveTextColor(colors.activeTextColor);
+    setActiveBackgroundColor(colors.activeBackgroundColor);
+    setLinkColor(colors.linkColor);
+    setLinkBackgroundColor(colors.linkBackgroundColor);
+    setVisitedLinkColor(colors.visitedLinkColor);
+    setVisitedLinkBackgroundColor(colors.visitedLinkBackgroundColor);
+    setNegativeTextColor(colors.negativeTextColor);
+    setNegativeBackgroundColor(colors.negativeBackgroundColor);
+    setNeutralTextColor(colors.neutralTextColor);
+    setNeutralBackgroundColor(colors.neutralBackgroundColor);
+    setPositiveTextColor(colors.positiveTextColor);
+    setPositiveBackgroundColor(colors.positiveBackgroundColor);
+
+    auto &definition = basicThemeInstance()->themeDefinition(engine);
     setDefaultFont(definition.defaultFont);
     setSmallFont(definition.smallFont);
 }
@@ -197,21 +337,6 @@ bool BasicTheme::event(QEvent *event)
     return PlatformTheme::event(event);
 }
 
-QColor BasicTheme::tint(const QColor &color)
-{
-    if (QQuickItem *item = qobject_cast<QQuickItem *>(parent()); item && !item->isEnabled()) {
-        return QColor::fromHsvF(color.hueF(), color.saturationF() * 0.5, color.valueF() * 0.8);
-    }
-    switch (colorGroup()) {
-    case PlatformTheme::Inactive:
-        return QColor::fromHsvF(color.hueF(), color.saturationF() * 0.5, color.valueF());
-    case PlatformTheme::Disabled:
-        return QColor::fromHsvF(color.hueF(), color.saturationF() * 0.5, color.valueF() * 0.8);
-    default:
-        return color;
-    }
-}
-
 }
 }
 
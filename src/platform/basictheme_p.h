@@ -9,6 +9,12 @@
 
 #include "platformtheme.h"
 
+#include <QPointer>
+#include <QQmlComponent>
+
+#include <array>
+#include <optional>
+
 #include "kirigamiplatform_export.h"
 
 namespace Kirigami
@@ -157,6 +163,31 @@ public:
     Q_SIGNAL void sync(QQuickItem *object);
 };
 
+// The colors of the theme definition for one colorSet, tinted for one colorGroup.
+struct BasicThemeColors {
+    QColor textColor;
+    QColor backgroundColor;
+    QColor alternateBackgroundColor;
+    QColor hoverColor;
+    QColor focusColor;
+
+    QColor disabledTextColor;
+    QColor highlightColor;
+    QColor highlightedTextColor;
+    QColor activeTextColor;
+    QColor activeBackgroundColor;
+    QColor linkColor;
+    QColor linkBackgroundColor;
+    QColor visitedLinkColor;
+    QColor visitedLinkBackgroundColor;
+    QColor negativeTextColor;
+    QColor negativeBackgroundColor;
+    QColor neutralTextColor;
+    QColor neutralBackgroundColor;
+    QColor positiveTextColor;
+    QColor positiveBackgroundColor;
+};
+
 class BasicThemeInstance : public QObject
 {
     Q_OBJECT
@@ -166,15 +197,37 @@ public:
 
     BasicThemeDefinition &themeDefinition(QQmlEngine *engine);
 
+    /*
+     * Starts compiling Theme.qml of the current style in the background, so
+     * that themeDefinition() does not have to when it is first needed.
+     */
+    void preload(QQmlEngine *engine);
+
+    /*
+     * The colors for colorSet and colorGroup, computed once per change of the
+     * theme definition.
+     */
+    const BasicThemeColors &colors(QQmlEngine *engine, PlatformTheme::ColorSet colorSet, PlatformTheme::ColorGroup colorGroup);
+
     QList<BasicTheme *> watchers;
 
 private:
     void onDefinitionChanged();
+    void updateColorTables();
+    QUrl themeUrl();
+
+    // PlatformTheme::ColorGroupCount aliases Disabled, as Normal equals Active
+    static constexpr int s_colorGroupCount = QPalette::NColorGroups;
 
     std::unique_ptr<BasicThemeDefinition> m_themeDefinition;
+    // Resolving the URL checks several paths for each style, only do it once
+    std::optional<QUrl> m_themeUrl;
+    // Owned by its engine
+    QPointer<QQmlComponent> m_preloadComponent;
+    std::array<BasicThemeColors, PlatformTheme::ColorSetCount * s_colorGroupCount> m_colorTables;
 };
 
-class BasicTheme : public PlatformTheme
+class KIRIGAMIPLATFORM_EXPORT BasicTheme : public PlatformTheme
 {
     Q_OBJECT
 
@@ -184,11 +237,15 @@ public:
 
     void sync();
 
+    /*
+     * Loads the theme definition used by BasicTheme for engine asynchronously,
+     * meant to be called when Kirigami is imported. Does nothing if a platform
+     * plugin provides the themes.
+     */
+    static void preloadDefinition(QQmlEngine *engine);
+
 protected:
     bool event(QEvent *event) override;
-
-private:
-    QColor tint(const QColor &color);
 };
 
 }
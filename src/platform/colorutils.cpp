@@ -8,6 +8,8 @@
 
 #include <QIcon>
 #include <QtMath>
+#include <array>
+#include <bit>
 #include <cmath>
 #include <map>
 
@@ -244,46 +246,74 @@ QColor ColorUtils::tintWithAlpha(const QColor &targetColor, const QColor &tintCo
                             tintAlpha + inverseAlpha * targetColor.alphaF());
 }
 
-ColorUtils::XYZColor ColorUtils::colorToXYZ(const QColor &color)
+// Fifth root by Newton's method, usable at compile time where std::pow is not.
+// Converges from above for 0 < a <= 1.
+static constexpr qreal fifthRoot(qreal a)
 {
-    // http://wiki.nuaj.net/index.php/Color_Transforms#RGB_.E2.86.92_XYZ
-    qreal r = color.redF();
-    qreal g = color.greenF();
-    qreal b = color.blueF();
-    // Apply gamma correction (i.e. conversion to linear-space)
-    auto correct = [](qreal &v) {
-        if (v > 0.04045) {
-            v = std::pow((v + 0.055) / 1.055, 2.4);
-        } else {
-            v = v / 12.92;
+    qreal y = 1;
+    for (int i = 0; i < 64; ++i) {
+        const qreal y2 = y * y;
+        const qreal next = (4 * y + a / (y2 * y2)) / 5;
+        if (next >= y) {
+            break;
         }
-    };
+        y = next;
+    }
+    return y;
+}
 
-    correct(r);
-    correct(g);
-    correct(b);
+// Gamma correction (i.e. conversion to linear-space) of a channel in [0, 1]
+static constexpr qreal srgbToLinear(qreal v)
+{
+    if (v > 0.04045) {
+        // x^2.4 == x^2 * x^(2/5)
+        const qreal x = (v + 0.055) / 1.055;
+        return x * x * fifthRoot(x * x);
+    }
+    return v / 12.92;
+}
+
+// Linear values of all 8-bit channel values, equal to std::pow() up to rounding
+static constexpr auto s_srgbToLinear = [] {
+    std::array<qreal, 256> table{};
+    for (int i = 0; i < 256; ++i) {
+        table[i] = srgbToLinear(i / 255.0);
+    }
+    return table;
+}();
+
+// Cube root for the Lab pivot, whose input lies in (0.008856, ~1.1]. A bit
+// level first guess, within a few percent, refined by two steps of Halley's
+// method to a relative error below 1e-14.
+static inline qreal fastCbrt(qreal v)
+{
+    qreal y = std::bit_cast<qreal>(std::bit_cast<quint64>(v) / 3 + 0x2a9f7893782da1ceULL);
+    for (int i = 0; i < 2; ++i) {
+        const qreal y3 = y * y * y;
+        y = y * (y3 + 2 * v) / (2 * y3 + v);
+    }
+    return y;
+}
 
+static ColorUtils::XYZColor linearToXYZ(qreal r, qreal g, qreal b)
+{
     // Observer. = 2°, Illuminant = D65
     const qreal x = r * 0.4124 + g * 0.3576 + b * 0.1805;
     const qreal y = r * 0.2126 + g * 0.7152 + b * 0.0722;
     const qreal z = r * 0.0193 + g * 0.1192 + b * 0.9505;
 
-    return XYZColor{x, y, z};
+    return ColorUtils::XYZColor{x, y, z};
 }
 
-ColorUtils::LabColor ColorUtils::colorToLab(const QColor &color)
+static ColorUtils::LabColor xyzToLab(const ColorUtils::XYZColor &xyz)
 {
-    // First: convert to XYZ
-    const auto xyz = colorToXYZ(color);
-
-    // Second: convert from XYZ to L*a*b
     qreal x = xyz.x / 0.95047; // Observer= 2°, Illuminant= D65
     qreal y = xyz.y / 1.0;
     qreal z = xyz.z / 1.08883;
 
     auto pivot = [](qreal &v) {
         if (v > 0.008856) {
-            v = std::pow(v, 1.0 / 3.0);
+            v = fastCbrt(v);
         } else {
             v = (7.787 * v) + (16.0 / 116.0);
         }
@@ -293,7 +323,7 @@ ColorUtils::LabColor ColorUtils::colorToLab(const QColor &color)
     pivot(y);
     pivot(z);
 
-    LabColor labColor;
+    ColorUtils::LabColor labColor;
     labColor.l = std::max(0.0, (116 * y) - 16);
     labColor.a = 500 * (x - y);
     labColor.b = 200 * (y - z);
@@ -301,12 +331,68 @@ ColorUtils::LabColor ColorUtils::colorToLab(const QColor &color)
     return labColor;
 }
 
+// Whether all channels of color are exactly representable with 8 bits
+static bool is8Bit(const QColor &color)
+{
+    const QRgba64 rgba = color.rgba64();
+    return rgba.red() % 257 == 0 && rgba.green() % 257 == 0 && rgba.blue() % 257 == 0;
+}
+
+ColorUtils::XYZColor ColorUtils::colorToXYZ(const QColor &color)
+{
+    if (is8Bit(color)) {
+        return rgbToXYZ(color.rgb());
+    }
+
+    // http://wiki.nuaj.net/index.php/Color_Transforms#RGB_.E2.86.92_XYZ
+    qreal r = color.redF();
+    qreal g = color.greenF();
+    qreal b = color.blueF();
+    // Apply gamma correction (i.e. conversion to linear-space)
+    auto correct = [](qreal &v) {
+        if (v > 0.04045) {
+            v = std::pow((v + 0.055) / 1.055, 2.4);
+        } else {
+            v = v / 12.92;
+        }
+    };
+
+    correct(r);
+    correct(g);
+    correct(b);
+
+    return linearToXYZ(r, g, b);
+}
+
+ColorUtils::XYZColor ColorUtils::rgbToXYZ(QRgb rgb)
+{
+    return linearToXYZ(s_srgbToLinear[qRed(rgb)], s_srgbToLinear[qGreen(rgb)], s_srgbToLinear[qBlue(rgb)]);
+}
+
+ColorUtils::LabColor ColorUtils::colorToLab(const QColor &color)
+{
+    // First: convert to XYZ
+    // Second: convert from XYZ to L*a*b
+    return xyzToLab(colorToXYZ(color));
+}
+
+ColorUtils::LabColor ColorUtils::rgbToLab(QRgb rgb)
+{
+    return xyzToLab(rgbToXYZ(rgb));
+}
+
 qreal ColorUtils::chroma(const QColor &color)
 {
     LabColor labColor = colorToLab(color);
 
     // Chroma is hypotenuse of a and b
-    return sqrt(pow(labColor.a, 2) + pow(labColor.b, 2));
+    return std::sqrt(labColor.a * labColor.a + labColor.b * labColor.b);
+}
+
+qreal ColorUtils::chromaRgb(QRgb rgb)
+{
+    const LabColor labColor = rgbToLab(rgb);
+    return std::sqrt(labColor.a * labColor.a + labColor.b * labColor.b);
 }
 
 qreal ColorUtils::luminance(const QColor &color)
@@ -316,4 +402,9 @@ qreal ColorUtils::luminance(const QColor &color)
     return xyz.y;
 }
 
+qreal ColorUtils::luminanceRgb(QRgb rgb)
+{
+    return rgbToXYZ(rgb).y;
+}
+
 #include "moc_colorutils.cpp"
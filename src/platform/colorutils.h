@@ -234,4 +234,16 @@ public:
     static ColorUtils::LabColor colorToLab(const QColor &color);
 
     static qreal luminance(const QColor &color);
+
+    // Not for QML, variants for 8-bit colors that skip constructing a QColor,
+    // for per-pixel use. Alpha is ignored. They have their own names since a
+    // QRgb overload would also be picked for Qt::GlobalColor arguments.
+    //
+    // Colors with 8-bit channels are linearized through a precomputed table and
+    // the Lab cube root is approximated; results match the exact formulas to
+    // within 1e-9. Other colors take the exact path.
+    static ColorUtils::XYZColor rgbToXYZ(QRgb rgb);
+    static ColorUtils::LabColor rgbToLab(QRgb rgb);
+    static qreal chromaRgb(QRgb rgb);
+    static qreal luminanceRgb(QRgb rgb);
 };
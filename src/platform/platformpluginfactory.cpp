@@ -7,10 +7,17 @@
 #include "platformpluginfactory.h"
 
 #include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QDebug>
 #include <QDir>
+#include <QFileInfo>
 #include <QPluginLoader>
 #include <QQuickStyle>
+#include <QSettings>
+#include <QStandardPaths>
+
+#include <algorithm>
 
 #include "kirigamiplatform_logging.h"
 
@@ -19,6 +26,68 @@ namespace Kirigami
 namespace Platform
 {
 
+#ifndef KIRIGAMI_BUILD_TYPE_STATIC
+// Where the plugin found for each style is remembered across runs, or an
+// empty string if that is disabled. It only saves the scan of the plugin
+// directories, which is worth a file per application only where that scan is
+// slow, so it is enabled with KIRIGAMI_PLATFORM_PLUGIN_CACHE=1.
+static QString pluginCachePath()
+{
+    if (qEnvironmentVariableIntValue("KIRIGAMI_PLATFORM_PLUGIN_CACHE") == 0) {
+        return QString();
+    }
+
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (cacheDir.isEmpty()) {
+        return QString();
+    }
+    return cacheDir + QStringLiteral("/kirigami/platformplugins.ini");
+}
+
+// Changes whenever a plugin is added to or removed from one of directories,
+// or the library paths change. Hashed so it can be used as a settings key.
+static QString directoriesFingerprint(const QStringList &directories)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const QString &directory : directories) {
+        const QFileInfo info(directory);
+        hash.addData(directory.toUtf8());
+        hash.addData(QByteArray::number(info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1));
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+// Whether the search below could have picked fileName, so that a tampered or
+// outdated cache does not make us load anything else.
+static bool isPluginCandidate(const QString &fileName, const QString &pluginName, const QStringList &directories)
+{
+    const QFileInfo info(fileName);
+    if (!info.fileName().contains(pluginName)) {
+        return false;
+    }
+#ifdef Q_OS_ANDROID
+    if (!info.fileName().startsWith(QStringLiteral("libplugins_kf6_kirigami_platform_"))) {
+        return false;
+    }
+#endif
+    const QString path = info.absolutePath();
+    return std::any_of(directories.cbegin(), directories.cend(), [&path](const QString &directory) {
+        return QDir(directory).absolutePath() == path;
+    });
+}
+
+static PlatformPluginFactory *loadPlugin(const QString &fileName)
+{
+    QPluginLoader loader(fileName);
+    QObject *plugin = loader.instance();
+    // TODO: load actually a factory as plugin
+
+    qCDebug(KirigamiPlatform) << "Loading style plugin from" << fileName;
+
+    return qobject_cast<PlatformPluginFactory *>(plugin);
+}
+#endif
+
 PlatformPluginFactory::PlatformPluginFactory(QObject *parent)
     : QObject(parent)
 {
@@ -48,14 +117,41 @@ PlatformPluginFactory *PlatformPluginFactory::findPlugin(const QString &preferre
         }
     }
 #else
+    QStringList directories;
     const auto libraryPaths = QCoreApplication::libraryPaths();
     for (const QString &path : libraryPaths) {
-
 #ifdef Q_OS_ANDROID
-        const QDir dir(path);
+        directories.append(path);
 #else
-        const QDir dir(path + QStringLiteral("/kf6/kirigami/platform"));
+        directories.append(path + QStringLiteral("/kf6/kirigami/platform"));
 #endif
+    }
+
+    // Try the file that provided the plugin last time first, if nothing was
+    // installed or removed in the meantime.
+    const QString cachePath = pluginCachePath();
+    const QString fingerprint = cachePath.isEmpty() ? QString() : directoriesFingerprint(directories);
+    if (!cachePath.isEmpty() && !pluginName.isEmpty()) {
+        QSettings cache(cachePath, QSettings::IniFormat);
+        cache.beginGroup(pluginName);
+        if (cache.contains(fingerprint)) {
+            const QString fileName = cache.value(fingerprint).toString();
+            if (fileName.isEmpty()) {
+                qCDebug(KirigamiPlatform) << "No Kirigami platform plugin for style" << pluginName << "according to" << cachePath;
+                return nullptr;
+            }
+            if (isPluginCandidate(fileName, pluginName, directories)) {
+                if (auto factory = loadPlugin(fileName)) {
+                    factories[pluginName] = factory;
+                    return factory;
+                }
+            }
+        }
+    }
+
+    QString pluginFileName;
+    for (const QString &directory : std::as_const(directories)) {
+        const QDir dir(directory);
 
         const auto fileNames = dir.entryList(QDir::Files);
 
@@ -66,14 +162,9 @@ PlatformPluginFactory *PlatformPluginFactory::findPlugin(const QString &preferre
 #endif
                 if (!pluginName.isEmpty() && fileName.contains(pluginName)) {
                     // TODO: env variable too?
-                    QPluginLoader loader(dir.absoluteFilePath(fileName));
-                    QObject *plugin = loader.instance();
-                    // TODO: load actually a factory as plugin
-
-                    qCDebug(KirigamiPlatform) << "Loading style plugin from" << dir.absoluteFilePath(fileName);
-
-                    if (auto factory = qobject_cast<PlatformPluginFactory *>(plugin)) {
+                    if (auto factory = loadPlugin(dir.absoluteFilePath(fileName))) {
                         factories[pluginName] = factory;
+                        pluginFileName = dir.absoluteFilePath(fileName);
                         break;
                     }
                 }
@@ -89,6 +180,16 @@ PlatformPluginFactory *PlatformPluginFactory::findPlugin(const QString &preferre
             break;
         }
     }
+
+    if (!cachePath.isEmpty() && !pluginName.isEmpty()) {
+        QSettings cache(cachePath, QSettings::IniFormat);
+        cache.beginGroup(pluginName);
+        if (!cache.contains(fingerprint) || cache.value(fingerprint).toString() != pluginFileName) {
+            // Entries for other fingerprints are outdated
+            cache.remove(QString());
+            cache.setValue(fingerprint, pluginFileName);
+        }
+    }
 #endif
 
     PlatformPluginFactory *factory = factories.value(pluginName);
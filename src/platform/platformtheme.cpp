@@ -9,10 +9,13 @@
 #include "basictheme_p.h"
 #include "platformpluginfactory.h"
 #include "stylehints.h"
+#include "systemfonts_p.h"
+#include "themestatistics_p.h"
 
+#include <QCache>
 #include <QDebug>
 #include <QDir>
-#include <QFontDatabase>
+#include <QElapsedTimer>
 #include <QGuiApplication>
 #include <QPluginLoader>
 #include <QPointer>
@@ -20,12 +23,16 @@
 #include <QQmlEngine>
 #include <QQuickStyle>
 #include <QQuickWindow>
+#include <QVarLengthArray>
 
+#include <algorithm>
 #include <array>
 #include <cinttypes>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <unordered_map>
+#include <utility>
 
 #include "kirigamiplatform_logging.h"
 
@@ -67,6 +74,42 @@ static TypeInitializer initializer;
 // This value has to be kept in sync with the value in KColorScheme kcolorscheme.cpp
 static constexpr qreal DefaultFrameContrast = 0.2;
 
+// Everything the colors a theme implementation sets on its own data are
+// expected to depend on. Non-inheriting themes without local overrides that
+// have the same key start out sharing one data object. The engine is part of
+// it as implementations may pick their definition per engine, e.g. from the
+// engine's _kirigamiTheme property or through the style Theme.qml it loads.
+struct PlatformThemeDataKey {
+    const QMetaObject *type = nullptr;
+    const QQmlEngine *engine = nullptr;
+    PlatformTheme::ColorSet colorSet = PlatformTheme::Window;
+    PlatformTheme::ColorGroup colorGroup = PlatformTheme::Active;
+    bool enabled = true;
+
+    bool operator==(const PlatformThemeDataKey &other) const = default;
+};
+
+inline size_t qHash(const PlatformThemeDataKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.type, key.engine, int(key.colorSet), int(key.colorGroup), key.enabled);
+}
+
+// Identifies an icon returned by PlatformTheme::iconFromTheme()
+struct PlatformThemeIconKey {
+    QString name;
+    quint64 color = 0;
+    const QMetaObject *type = nullptr;
+    QString iconTheme;
+    qint64 palette = 0;
+
+    bool operator==(const PlatformThemeIconKey &other) const = default;
+};
+
+inline size_t qHash(const PlatformThemeIconKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.name, key.color, key.type, key.iconTheme, key.palette);
+}
+
 // This class encapsulates the actual data of the Theme object. It may be shared
 // among several instances of PlatformTheme, to ensure that the memory usage of
 // PlatformTheme stays low.
@@ -108,18 +151,42 @@ public:
 
     using ColorMap = std::unordered_map<std::underlying_type<ColorRole>::type, QColor>;
 
+    PlatformThemeData()
+    {
+        ++s_count;
+    }
+
+    ~PlatformThemeData() override
+    {
+        --s_count;
+        if (interned) {
+            --ThemeStatisticsPrivate::s_sharedDataBlocks;
+        }
+    }
+
+    // Number of instances alive, for PlatformTheme::dataBlockCount()
+    inline static int s_count = 0;
+
     // Which PlatformTheme instance "owns" this data object. Only the owner is
-    // allowed to make changes to data.
+    // allowed to make changes to data. Shared data has no owner, the themes
+    // sharing it need to detach before making changes.
     QPointer<PlatformTheme> owner;
 
+    // Interned data is offered to all themes of the same key that do not
+    // inherit. See PlatformThemePrivate::detachData() and internData().
+    bool interned = false;
+    PlatformThemeDataKey key;
+    // Number of themes using this as their own, non-inherited, data
+    int sharers = 0;
+
     PlatformTheme::ColorSet colorSet = PlatformTheme::Window;
     PlatformTheme::ColorGroup colorGroup = PlatformTheme::Active;
 
     std::array<QColor, ColorRoleCount> colors;
 
     QFont defaultFont;
-    QFont smallFont = QFontDatabase::systemFont(QFontDatabase::SmallestReadableFont);
-    QFont fixedWidthFont = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    QFont smallFont = SystemFonts::smallFont();
+    QFont fixedWidthFont = SystemFonts::fixedWidthFont();
 
     QPalette palette;
 
@@ -132,6 +199,95 @@ public:
 
     qreal frameContrast = DefaultFrameContrast;
 
+    // State of an open transaction, see beginTransaction().
+    int transactionDepth = 0;
+    PlatformThemeChangeTracker::PropertyChanges stagedChanges;
+    PlatformTheme::ColorSet stagedColorSet = PlatformTheme::Window;
+    PlatformTheme::ColorGroup stagedColorGroup = PlatformTheme::Active;
+    qreal stagedFrameContrast = DefaultFrameContrast;
+    // Value of each color and font before the transaction changed it
+    std::array<std::optional<QColor>, ColorRoleCount> stagedColors;
+    std::optional<QFont> stagedDefaultFont;
+    std::optional<QFont> stagedSmallFont;
+    std::optional<QFont> stagedFixedWidthFont;
+
+    // Stage all changes until the matching commitTransaction(). Applying a
+    // full set of colors then rebuilds the palette once and sends each
+    // watcher the events for all changed values inside a single change
+    // tracker, instead of one palette rebuild and one round of signals per
+    // watcher for every color. Transactions nest.
+    inline void beginTransaction()
+    {
+        ++transactionDepth;
+    }
+
+    inline void commitTransaction()
+    {
+        if (transactionDepth > 1) {
+            --transactionDepth;
+            return;
+        }
+
+        // Watchers react to the events by changing the data again, e.g. a
+        // colorSet change makes themes apply the colors of the new set. The
+        // transaction stays open while events are delivered so those changes
+        // are staged as well, and delivered in the next round.
+        while (stagedChanges.toInt() != 0) {
+            const auto changes = std::exchange(stagedChanges, PlatformThemeChangeTracker::PropertyChanges{});
+            const auto oldColors = std::exchange(stagedColors, {});
+            const std::array<std::pair<std::optional<QFont>, const QFont *>, 3> oldFonts{{
+                {std::exchange(stagedDefaultFont, std::nullopt), &defaultFont},
+                {std::exchange(stagedSmallFont, std::nullopt), &smallFont},
+                {std::exchange(stagedFixedWidthFont, std::nullopt), &fixedWidthFont},
+            }};
+
+            if (changes & PlatformThemeChangeTracker::PropertyChange::Color) {
+                updatePalette(palette, colors);
+            }
+
+            // Only the owner can change data, so it is the sender of everything staged.
+            PlatformTheme *sender = owner;
+            const auto currentWatchers = watchers;
+            for (auto object : currentWatchers) {
+                PlatformThemeChangeTracker tracker(object);
+
+                if (changes & PlatformThemeChangeTracker::PropertyChange::ColorSet) {
+                    PlatformThemeEvents::ColorSetChangedEvent event(sender, stagedColorSet, colorSet);
+                    QCoreApplication::sendEvent(object, &event);
+                    ThemeStatisticsPrivate::countNotification();
+                }
+                if (changes & PlatformThemeChangeTracker::PropertyChange::ColorGroup) {
+                    PlatformThemeEvents::ColorGroupChangedEvent event(sender, stagedColorGroup, colorGroup);
+                    QCoreApplication::sendEvent(object, &event);
+                    ThemeStatisticsPrivate::countNotification();
+                }
+                // One event per value that differs from before the
+                // transaction, as if they had been set one by one.
+                for (std::size_t role = 0; role < colors.size(); ++role) {
+                    if (oldColors[role] && *oldColors[role] != colors[role]) {
+                        PlatformThemeEvents::ColorChangedEvent event(sender, *oldColors[role], colors[role]);
+                        QCoreApplication::sendEvent(object, &event);
+                        ThemeStatisticsPrivate::countNotification();
+                    }
+                }
+                for (const auto &[oldFont, font] : oldFonts) {
+                    if (oldFont && *oldFont != *font) {
+                        PlatformThemeEvents::FontChangedEvent event(sender, *oldFont, *font);
+                        QCoreApplication::sendEvent(object, &event);
+                        ThemeStatisticsPrivate::countNotification();
+                    }
+                }
+                if (changes & PlatformThemeChangeTracker::PropertyChange::FrameContrast) {
+                    PlatformThemeEvents::FrameContrastChangedEvent event(sender, stagedFrameContrast, frameContrast);
+                    QCoreApplication::sendEvent(object, &event);
+                    ThemeStatisticsPrivate::countNotification();
+                }
+            }
+        }
+
+        transactionDepth = 0;
+    }
+
     inline void setColorSet(PlatformTheme *sender, PlatformTheme::ColorSet set)
     {
         if (sender != owner || colorSet == set) {
@@ -142,6 +298,10 @@ public:
 
         colorSet = set;
 
+        if (stage(PlatformThemeChangeTracker::PropertyChange::ColorSet, stagedColorSet, oldValue)) {
+            return;
+        }
+
         notifyWatchers<PlatformTheme::ColorSet>(sender, oldValue, set);
     }
 
@@ -156,6 +316,10 @@ public:
         colorGroup = group;
         palette.setCurrentColorGroup(QPalette::ColorGroup(group));
 
+        if (stage(PlatformThemeChangeTracker::PropertyChange::ColorGroup, stagedColorGroup, oldValue)) {
+            return;
+        }
+
         notifyWatchers<PlatformTheme::ColorGroup>(sender, oldValue, group);
     }
 
@@ -168,6 +332,11 @@ public:
         auto oldValue = colors[role];
 
         colors[role] = color;
+
+        if (stage(PlatformThemeChangeTracker::PropertyChange::Color, stagedColors[role], oldValue)) {
+            return;
+        }
+
         updatePalette(palette, colors);
 
         notifyWatchers<QColor>(sender, oldValue, colors[role]);
@@ -183,6 +352,10 @@ public:
 
         defaultFont = font;
 
+        if (stage(PlatformThemeChangeTracker::PropertyChange::Font, stagedDefaultFont, oldValue)) {
+            return;
+        }
+
         notifyWatchers<QFont>(sender, oldValue, font);
     }
 
@@ -196,6 +369,10 @@ public:
 
         smallFont = font;
 
+        if (stage(PlatformThemeChangeTracker::PropertyChange::Font, stagedSmallFont, oldValue)) {
+            return;
+        }
+
         notifyWatchers<QFont>(sender, oldValue, smallFont);
     }
 
@@ -209,9 +386,41 @@ public:
 
         fixedWidthFont = font;
 
+        if (stage(PlatformThemeChangeTracker::PropertyChange::Font, stagedFixedWidthFont, oldValue)) {
+            return;
+        }
+
         notifyWatchers<QFont>(sender, oldValue, fixedWidthFont);
     }
 
+    inline bool hasSameValues(const PlatformThemeData &other) const
+    {
+        return colorSet == other.colorSet //
+            && colorGroup == other.colorGroup //
+            && colors == other.colors //
+            && defaultFont == other.defaultFont //
+            && smallFont == other.smallFont //
+            && fixedWidthFont == other.fixedWidthFont //
+            && palette == other.palette //
+            && frameContrast == other.frameContrast;
+    }
+
+    // Copy of all values, without watchers, owner or transaction state
+    inline std::shared_ptr<PlatformThemeData> clone() const
+    {
+        auto copy = std::make_shared<PlatformThemeData>();
+        copy->colorSet = colorSet;
+        copy->colorGroup = colorGroup;
+        copy->colors = colors;
+        copy->defaultFont = defaultFont;
+        copy->smallFont = smallFont;
+        copy->fixedWidthFont = fixedWidthFont;
+        copy->palette = palette;
+        copy->frameContrast = frameContrast;
+        copy->key = key;
+        return copy;
+    }
+
     inline void addChangeWatcher(PlatformTheme *object)
     {
         watchers.append(object);
@@ -222,12 +431,43 @@ public:
         watchers.removeOne(object);
     }
 
+    // Records change if a transaction is open, returns whether it did.
+    inline bool stage(PlatformThemeChangeTracker::PropertyChange change)
+    {
+        if (transactionDepth == 0) {
+            return false;
+        }
+        stagedChanges |= change;
+        return true;
+    }
+
+    // Same, also keeping the value from before the transaction.
+    template<typename T>
+    inline bool stage(PlatformThemeChangeTracker::PropertyChange change, T &stagedValue, const T &oldValue)
+    {
+        if (transactionDepth > 0 && !(stagedChanges & change)) {
+            stagedValue = oldValue;
+        }
+        return stage(change);
+    }
+
+    // Same, for one of several values that are reported separately.
+    template<typename T>
+    inline bool stage(PlatformThemeChangeTracker::PropertyChange change, std::optional<T> &stagedValue, const T &oldValue)
+    {
+        if (transactionDepth > 0 && !stagedValue) {
+            stagedValue = oldValue;
+        }
+        return stage(change);
+    }
+
     template<typename T>
     inline void notifyWatchers(PlatformTheme *sender, const T &oldValue, const T &newValue)
     {
         for (auto object : std::as_const(watchers)) {
             PlatformThemeEvents::PropertyChangedEvent<T> event(sender, oldValue, newValue);
             QCoreApplication::sendEvent(object, &event);
+            ThemeStatisticsPrivate::countNotification();
         }
     }
 
@@ -292,6 +532,10 @@ public:
 
         frameContrast = contrast;
 
+        if (stage(PlatformThemeChangeTracker::PropertyChange::FrameContrast, stagedFrameContrast, oldValue)) {
+            return;
+        }
+
         notifyWatchers<qreal>(sender, oldValue, frameContrast);
     }
 };
@@ -318,7 +562,7 @@ public:
 
         QColor value = data->colors.at(color);
 
-        if (data->owner != theme && localOverrides) {
+        if (!ownsData && localOverrides) {
             auto itr = localOverrides->find(color);
             if (itr != localOverrides->end()) {
                 value = itr->second;
@@ -342,6 +586,7 @@ public:
                 localOverrides->erase(itr);
 
                 if (data) {
+                    detachData(theme);
                     // TODO: Find a better way to determine "default" color.
                     // Right now this sets the color to transparent to force a
                     // color change and relies on the style-specific subclass to
@@ -354,7 +599,7 @@ public:
         }
 
         auto itr = localOverrides->find(color);
-        if (itr != localOverrides->end() && itr->second == value && (data && data->owner != theme)) {
+        if (itr != localOverrides->end() && itr->second == value && (data && !ownsData)) {
             return;
         }
 
@@ -363,6 +608,7 @@ public:
         (*localOverrides)[color] = value;
 
         if (data) {
+            detachData(theme);
             data->setColor(theme, color, value);
         }
     }
@@ -383,8 +629,9 @@ public:
         // Only mark colors as changed if the value will actually change; the
         // subclasses reset all colors when e.g. the window's active state
         // changes.
-        if (data && data->owner == theme && data->colors[color] != value) {
+        if (data && ownsData && data->colors[color] != value) {
             PlatformThemeChangeTracker tracker(theme, PlatformThemeChangeTracker::PropertyChange::Color);
+            detachData(theme);
             data->setColor(theme, color, value);
         }
     }
@@ -397,6 +644,158 @@ public:
      * works the same without needing memory.
      */
 
+    // Links into the tree of all PlatformTheme instances, where the parent of
+    // each is the theme of its nearest ancestor that has one. Propagating
+    // inheritance changes only walks this tree rather than all items.
+    inline void setParentTheme(PlatformTheme *theme, PlatformTheme *parent)
+    {
+        if (parentTheme == parent) {
+            return;
+        }
+
+        if (parentTheme) {
+            auto &first = parentTheme->d->firstChildTheme;
+            if (first == theme) {
+                first = nextSiblingTheme;
+            }
+            if (previousSiblingTheme) {
+                previousSiblingTheme->d->nextSiblingTheme = nextSiblingTheme;
+            }
+            if (nextSiblingTheme) {
+                nextSiblingTheme->d->previousSiblingTheme = previousSiblingTheme;
+            }
+            previousSiblingTheme = nullptr;
+            nextSiblingTheme = nullptr;
+        }
+
+        parentTheme = parent;
+
+        if (parentTheme) {
+            auto &first = parentTheme->d->firstChildTheme;
+            nextSiblingTheme = first;
+            if (first) {
+                first->d->previousSiblingTheme = theme;
+            }
+            first = theme;
+        }
+    }
+
+    template<typename Function>
+    inline void forEachChildTheme(const Function &function) const
+    {
+        for (auto child = firstChildTheme; child; child = child->d->nextSiblingTheme) {
+            function(child);
+        }
+    }
+
+    // Sets the data theme uses as its own, rather than inherits.
+    inline void setOwnData(std::shared_ptr<PlatformThemeData> newData)
+    {
+        if (ownsData && data && --data->sharers == 0 && data->interned) {
+            // Themes still inheriting it move on with the next child update,
+            // don't hand it to new themes in the meantime.
+            unintern(data.get());
+        }
+        data = std::move(newData);
+        ownsData = bool(data);
+        if (data) {
+            ++data->sharers;
+        }
+    }
+
+    inline void setInheritedData(std::shared_ptr<PlatformThemeData> newData)
+    {
+        setOwnData(nullptr);
+        data = std::move(newData);
+    }
+
+    // Shared data is copy-on-write: a theme about to change it gets a copy of
+    // its own first. Themes inheriting from it are moved over to the copy by
+    // the child update that follows.
+    inline void detachData(PlatformTheme *theme)
+    {
+        if (!ownsData || !data || data->owner) {
+            return;
+        }
+
+        PlatformThemeChangeTracker tracker(theme);
+
+        if (data->sharers == 1) {
+            // Nobody else uses it, stop sharing instead of copying
+            if (data->interned) {
+                unintern(data.get());
+            }
+            data->owner = theme;
+        } else {
+            auto copy = data->clone();
+            copy->owner = theme;
+            data->removeChangeWatcher(theme);
+            copy->addChangeWatcher(theme);
+            setOwnData(copy);
+            tracker.markDirty(PlatformThemeChangeTracker::PropertyChange::Data);
+        }
+
+        // The changes that follow belong to the transaction of the outermost
+        // tracker, which could not open one on data it did not own.
+        if (auto tracked = PlatformThemeChangeTracker::s_blockedChanges.value(theme).lock(); tracked && !tracked->transaction) {
+            tracked->transaction = data;
+            data->beginTransaction();
+        }
+    }
+
+    // Removes data from the interned data, so that no theme joins it anymore
+    static void unintern(PlatformThemeData *data)
+    {
+        auto itr = s_internedData.find(data->key);
+        if (itr != s_internedData.end() && (itr->expired() || itr->lock().get() == data)) {
+            s_internedData.erase(itr);
+        }
+        data->interned = false;
+        --ThemeStatisticsPrivate::s_sharedDataBlocks;
+    }
+
+    // Shares the data of theme once a change to it is done, and the
+    // implementation filled in the values for its new settings: it joins the
+    // interned data of the same key if that has the same values, or becomes
+    // the interned data of that key otherwise. Without this every theme that
+    // detached, e.g. to switch its colorGroup when the window is deactivated,
+    // would keep a copy of its own.
+    //
+    // Replaced interned data stays shared by its themes until they make the
+    // same change and join the new one.
+    inline void internData(PlatformTheme *theme)
+    {
+        if (!ownsData || !data || data->owner != theme || localOverrides) {
+            return;
+        }
+
+        const auto key = dataKey(theme, data->colorSet, data->colorGroup);
+        if (auto interned = s_internedData.value(key).lock()) {
+            if (interned->hasSameValues(*data)) {
+                auto oldData = data;
+                setOwnData(interned);
+
+                PlatformThemeEvents::DataChangedEvent event{theme, oldData, data};
+                QCoreApplication::sendEvent(theme, &event);
+                return;
+            }
+            unintern(interned.get());
+        }
+
+        s_internedData.insert(key, data);
+        data->key = key;
+        data->interned = true;
+        data->owner = nullptr;
+        ++ThemeStatisticsPrivate::s_sharedDataBlocks;
+    }
+
+    static PlatformThemeDataKey dataKey(PlatformTheme *theme, PlatformTheme::ColorSet colorSet, PlatformTheme::ColorGroup colorGroup)
+    {
+        QObject *parent = theme->parent();
+        auto item = qobject_cast<QQuickItem *>(parent);
+        return PlatformThemeDataKey{theme->metaObject(), parent ? qmlEngine(parent) : nullptr, colorSet, colorGroup, !item || item->isEnabled()};
+    }
+
     // An instance of the data object. This is potentially shared with many
     // instances of PlatformTheme.
     std::shared_ptr<PlatformThemeData> data;
@@ -404,12 +803,22 @@ public:
     // demand and will only exist if we actually have local overrides.
     std::unique_ptr<PlatformThemeData::ColorMap> localOverrides;
 
+    PlatformTheme *parentTheme = nullptr;
+    PlatformTheme *firstChildTheme = nullptr;
+    PlatformTheme *previousSiblingTheme = nullptr;
+    PlatformTheme *nextSiblingTheme = nullptr;
+    // To the parentChanged signal of the items between ours and the one of
+    // parentTheme, moving any of them can give us another parent theme.
+    QList<QMetaObject::Connection> ancestorConnections;
+
     bool inherit : 1;
     bool supportsIconColoring : 1; // TODO KF6: Remove in favour of virtual method
     bool pendingColorChange : 1;
     bool pendingChildUpdate : 1;
     bool useAlternateBackgroundColor : 1;
     bool isConstructing : 1 = false;
+    // Whether data is our own, possibly interned, rather than inherited
+    bool ownsData : 1 = false;
 
     // Note: We use these to store local values of PlatformTheme::ColorSet and
     // PlatformTheme::ColorGroup. While these are standard enums and thus 32
@@ -424,16 +833,73 @@ public:
     static_assert(PlatformTheme::ColorSetCount <= 16, "PlatformTheme::ColorSet contains more elements than can be stored in PlatformThemePrivate");
 
     inline static PlatformPluginFactory *s_pluginFactory = nullptr;
+
+    // Themes whose data changed and whose descendants still need to update
+    // their inheritance, see PlatformTheme::scheduleChildUpdate().
+    inline static QList<PlatformTheme *> s_pendingChildUpdates;
+    inline static bool s_processingChildUpdates = false;
+
+    inline static QHash<PlatformThemeDataKey, std::weak_ptr<PlatformThemeData>> s_internedData;
+
+    // Icons by name, color and everything else iconFromTheme() depends on,
+    // see PlatformTheme::cachedIconFromTheme().
+    inline static QCache<PlatformThemeIconKey, QIcon> s_iconCache{256};
 };
 
+// Finds the themes below object that have no other theme in between.
+static void findChildThemes(QObject *object, QVarLengthArray<PlatformTheme *, 16> &result)
+{
+    if (!object) {
+        return;
+    }
+
+    // Walk the tree below object, without descending into objects that have a
+    // theme of their own.
+    QVarLengthArray<QObject *, 64> stack;
+
+    auto pushChildren = [&stack](QObject *object) {
+        // The item hierarchy may be different from the QObject hierarchy. We
+        // want to make sure that we find both child Items as well as any
+        // child objects, but visit items that are both only once.
+        auto item = qobject_cast<QQuickItem *>(object);
+        if (item) {
+            for (auto childItem : item->childItems()) {
+                stack.append(childItem);
+            }
+        }
+        for (auto child : object->children()) {
+            auto childItem = qobject_cast<QQuickItem *>(child);
+            if (!item || !childItem || childItem->parentItem() != item) {
+                stack.append(child);
+            }
+        }
+    };
+
+    pushChildren(object);
+    while (!stack.isEmpty()) {
+        QObject *child = stack.takeLast();
+
+        auto t = static_cast<PlatformTheme *>(qmlAttachedPropertiesObject<PlatformTheme>(child, false));
+        if (t) {
+            result.append(t);
+        } else {
+            pushChildren(child);
+        }
+    }
+}
+
 PlatformTheme::PlatformTheme(QObject *parent)
     : QObject(parent)
     , d(new PlatformThemePrivate)
 {
+    ++ThemeStatisticsPrivate::s_themes;
     setConstructing(true);
     if (QQuickItem *item = qobject_cast<QQuickItem *>(parent)) {
         connect(item, &QQuickItem::windowChanged, this, &PlatformTheme::update);
-        connect(item, &QQuickItem::parentChanged, this, &PlatformTheme::update);
+        connect(item, &QQuickItem::parentChanged, this, [this]() {
+            update();
+            watchAncestors();
+        });
         // Needs to be connected to enabledChanged twice to correctly fully update when a
         // Theme that does inherit becomes temporarily non-inherit and back due to
         // the item being enabled or disabled.
@@ -441,15 +907,38 @@ PlatformTheme::PlatformTheme(QObject *parent)
         connect(item, &QQuickItem::enabledChanged, this, &PlatformTheme::update, Qt::QueuedConnection);
     }
 
+    // Themes further down may have been created before this one, those
+    // now have this one as nearest themed ancestor.
+    QVarLengthArray<PlatformTheme *, 16> childThemes;
+    findChildThemes(parent, childThemes);
+    for (auto child : std::as_const(childThemes)) {
+        child->d->setParentTheme(child, this);
+        child->watchAncestors();
+    }
+
     update();
+    watchAncestors();
     setConstructing(false);
 }
 
 PlatformTheme::~PlatformTheme()
 {
+    --ThemeStatisticsPrivate::s_themes;
+
     if (d->data) {
         d->data->removeChangeWatcher(this);
     }
+    d->setOwnData(nullptr);
+
+    // Hand our children over to the next theme up
+    while (auto child = d->firstChildTheme) {
+        child->d->setParentTheme(child, d->parentTheme);
+    }
+    d->setParentTheme(this, nullptr);
+
+    if (d->pendingChildUpdate) {
+        std::replace(PlatformThemePrivate::s_pendingChildUpdates.begin(), PlatformThemePrivate::s_pendingChildUpdates.end(), this, static_cast<PlatformTheme *>(nullptr));
+    }
 
     delete d;
 }
@@ -460,6 +949,9 @@ void PlatformTheme::setColorSet(PlatformTheme::ColorSet colorSet)
     d->colorSet = colorSet;
 
     if (d->data) {
+        if (d->data->colorSet != colorSet) {
+            d->detachData(this);
+        }
         d->data->setColorSet(this, colorSet);
     }
 }
@@ -475,6 +967,9 @@ void PlatformTheme::setColorGroup(PlatformTheme::ColorGroup colorGroup)
     d->colorGroup = colorGroup;
 
     if (d->data) {
+        if (d->data->colorGroup != colorGroup) {
+            d->detachData(this);
+        }
         d->data->setColorGroup(this, colorGroup);
     }
 }
@@ -711,6 +1206,9 @@ void PlatformTheme::setDefaultFont(const QFont &font)
 {
     PlatformThemeChangeTracker tracker(this, PlatformThemeChangeTracker::PropertyChange::Font);
     if (d->data) {
+        if (d->data->defaultFont != font) {
+            d->detachData(this);
+        }
         d->data->setDefaultFont(this, font);
     }
 }
@@ -724,6 +1222,9 @@ void PlatformTheme::setSmallFont(const QFont &font)
 {
     PlatformThemeChangeTracker tracker(this, PlatformThemeChangeTracker::PropertyChange::Font);
     if (d->data) {
+        if (d->data->smallFont != font) {
+            d->detachData(this);
+        }
         d->data->setSmallFont(this, font);
     }
 }
@@ -737,6 +1238,9 @@ void PlatformTheme::setFixedWidthFont(const QFont &font)
 {
     PlatformThemeChangeTracker tracker(this, PlatformThemeChangeTracker::PropertyChange::Font);
     if (d->data) {
+        if (d->data->fixedWidthFont != font) {
+            d->detachData(this);
+        }
         d->data->setFixedWidthFont(this, font);
     }
 }
@@ -745,6 +1249,9 @@ void PlatformTheme::setFrameContrast(qreal contrast)
 {
     PlatformThemeChangeTracker tracker(this, PlatformThemeChangeTracker::PropertyChange::FrameContrast);
     if (d->data) {
+        if (d->data->frameContrast != contrast) {
+            d->detachData(this);
+        }
         d->data->setFrameContrast(this, contrast);
     }
 }
@@ -912,6 +1419,28 @@ QIcon PlatformTheme::iconFromTheme(const QString &name, const QColor &customColo
     return icon;
 }
 
+QIcon PlatformTheme::cachedIconFromTheme(const QString &name, const QColor &customColor)
+{
+    // Local color overrides change the palette icons may be recolored with
+    // but not the palette of the data that is part of the key. Themes with
+    // overrides are rare enough to not bother caching their icons.
+    if (!d->data || d->localOverrides) {
+        return iconFromTheme(name, customColor);
+    }
+
+    // The palette's cache key changes with any change to the colors, which
+    // recolored icons may depend on besides the custom color.
+    const PlatformThemeIconKey key{name, quint64(customColor.rgba64()), metaObject(), QIcon::themeName(), d->data->palette.cacheKey()};
+    auto &cache = PlatformThemePrivate::s_iconCache;
+    if (const QIcon *icon = cache.object(key)) {
+        return *icon;
+    }
+
+    const QIcon icon = iconFromTheme(name, customColor);
+    cache.insert(key, new QIcon(icon));
+    return icon;
+}
+
 bool PlatformTheme::supportsIconColoring() const
 {
     return d->supportsIconColoring;
@@ -985,7 +1514,7 @@ void PlatformTheme::emitSignalsForChanges(int changes)
     }
 
     if (propertyChanges & PlatformThemeChangeTracker::PropertyChange::Data) {
-        updateChildren(parent());
+        scheduleChildUpdate();
     }
 }
 
@@ -1043,6 +1572,8 @@ bool PlatformTheme::event(QEvent *event)
 
 void PlatformTheme::update()
 {
+    d->setParentTheme(this, findParentTheme());
+
     auto parentItem = qobject_cast<QQuickItem *>(parent());
     if (parentItem && !parentItem->window()) {
         // Do nothing if we don't have a window, to prevent spurious update events
@@ -1069,13 +1600,13 @@ void PlatformTheme::update()
             }
 
             auto t = static_cast<PlatformTheme *>(qmlAttachedPropertiesObject<PlatformTheme>(candidate, false));
-            if (t && t->d->data && t->d->data->owner == t) {
-                if (d->data == t->d->data) {
+            if (t && t->d->data && t->d->ownsData) {
+                if (d->data == t->d->data && !d->ownsData) {
                     // Inheritance is already correct, do nothing.
                     return;
                 }
 
-                d->data = t->d->data;
+                d->setInheritedData(t->d->data);
 
                 PlatformThemeEvents::DataChangedEvent event{this, oldData, t->d->data};
                 QCoreApplication::sendEvent(this, &event);
@@ -1083,25 +1614,44 @@ void PlatformTheme::update()
                 return;
             }
         }
-    } else if (d->data && d->data->owner != this) {
+    } else if (d->data && !d->ownsData) {
         // Inherit has changed and we no longer want to inherit, clear the data
         // so it is recreated below.
         d->data = nullptr;
+    } else if (d->data && d->ownsData && !d->data->owner && d->data->key != PlatformThemePrivate::dataKey(this, d->data->colorSet, d->data->colorGroup)) {
+        // The shared data is for other settings than ours now, e.g. because
+        // the item got disabled.
+        d->setOwnData(nullptr);
     }
 
-    if (!d->data) {
-        d->data = std::make_shared<PlatformThemeData>();
-        d->data->owner = this;
+    // If we normally inherit but do not do so currently due to an override,
+    // copy over the old colorSet to ensure we do not suddenly change to a
+    // different colorSet.
+    const auto colorSet = d->inherit && !actualInherit && oldData ? oldData->colorSet : static_cast<ColorSet>(d->colorSet);
+    const auto key = PlatformThemePrivate::dataKey(this, colorSet, static_cast<ColorGroup>(d->colorGroup));
+
+    const bool created = !d->data;
+    bool joined = false;
+    if (created) {
+        if (!d->localOverrides) {
+            if (auto interned = PlatformThemePrivate::s_internedData.value(key).lock()) {
+                d->setOwnData(interned);
+                joined = true;
+            }
+        }
+        if (!joined) {
+            d->setOwnData(std::make_shared<PlatformThemeData>());
+            d->data->owner = this;
+            d->data->key = key;
+        }
+    }
 
-        d->data->setColorSet(this, static_cast<ColorSet>(d->colorSet));
-        d->data->setColorGroup(this, static_cast<ColorGroup>(d->colorGroup));
+    // Apply the colorSet, colorGroup and local overrides together
+    d->data->beginTransaction();
 
-        // If we normally inherit but do not do so currently due to an override,
-        // copy over the old colorSet to ensure we do not suddenly change to a
-        // different colorSet.
-        if (d->inherit && !actualInherit && oldData) {
-            d->data->setColorSet(this, oldData->colorSet);
-        }
+    if (created && !joined) {
+        d->data->setColorSet(this, colorSet);
+        d->data->setColorGroup(this, static_cast<ColorGroup>(d->colorGroup));
     }
 
     if (d->localOverrides) {
@@ -1110,43 +1660,114 @@ void PlatformTheme::update()
         }
     }
 
+    d->data->commitTransaction();
+
     PlatformThemeEvents::DataChangedEvent event{this, oldData, d->data};
     QCoreApplication::sendEvent(this, &event);
 }
 
-void PlatformTheme::updateChildren(QObject *object)
+int PlatformTheme::dataBlockCount()
 {
-    if (!object) {
+    return PlatformThemeData::s_count;
+}
+
+void PlatformTheme::scheduleChildUpdate()
+{
+    if (d->pendingChildUpdate) {
         return;
     }
 
-    auto updateChildrenImpl = [this](const auto &children, QSet<QObject *> &updated) {
-        for (auto child : children) {
-            if (updated.contains(child)) {
-                continue;
-            }
+    d->pendingChildUpdate = true;
+    auto &pending = PlatformThemePrivate::s_pendingChildUpdates;
+    pending.append(this);
 
-            auto t = static_cast<PlatformTheme *>(qmlAttachedPropertiesObject<PlatformTheme>(child, false));
-            if (t) {
-                t->update();
-            } else {
-                updateChildren(child);
-            }
-            updated.insert(child);
+    if (PlatformThemePrivate::s_processingChildUpdates) {
+        // Picked up by the loop below, further up the stack
+        return;
+    }
+
+    // Updating the children of a theme changes the data of some of them,
+    // which schedules their children in turn. Processing those from a flat
+    // queue rather than recursively means every theme is handled at most once
+    // per change no matter how often it was scheduled, and keeps the stack
+    // flat for deep trees.
+    //
+    // Only the propagation of a single change is coalesced: the queue is
+    // drained before returning to the caller, so consecutive changes are
+    // each propagated in full. Deferring to the event loop or the next polish
+    // would leave bindings on inherited colors outdated until then, and
+    // those are expected to be up to date right after changing a theme.
+    QElapsedTimer timer;
+    if (ThemeStatisticsPrivate::isEnabled()) {
+        timer.start();
+    }
+
+    PlatformThemePrivate::s_processingChildUpdates = true;
+    for (qsizetype i = 0; i < pending.size(); ++i) {
+        if (auto theme = pending.at(i)) {
+            theme->d->pendingChildUpdate = false;
+            theme->updateChildren();
         }
-    };
+    }
+    pending.clear();
+    PlatformThemePrivate::s_processingChildUpdates = false;
 
-    auto item = qobject_cast<QQuickItem *>(object);
-    QSet<QObject *> updated;
-    // The item hierarchy may be different from the QObject hierarchy. We want
-    // to make sure that we update both child Items as well as any child objects.
-    // To prevent updating things that were already updated, keep track of them
-    // in a set that is used to skip an update for a child if it was already
-    // updated.
-    if (item) {
-        updateChildrenImpl(item->childItems(), updated);
+    if (timer.isValid()) {
+        ThemeStatisticsPrivate::countPropagation(timer.nsecsElapsed());
+    }
+}
+
+void PlatformTheme::updateChildren()
+{
+    // Updating may move children elsewhere in the tree, so don't update
+    // while iterating.
+    QVarLengthArray<PlatformTheme *, 16> children;
+    d->forEachChildTheme([&children](PlatformTheme *child) {
+        children.append(child);
+    });
+
+    for (auto child : std::as_const(children)) {
+        child->update();
+    }
+}
+
+PlatformTheme *PlatformTheme::findParentTheme()
+{
+    QObject *candidate = parent();
+    while ((candidate = determineParent(candidate))) {
+        if (auto t = static_cast<PlatformTheme *>(qmlAttachedPropertiesObject<PlatformTheme>(candidate, false))) {
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+// Items without a theme do not tell the themes below them when they are
+// moved, so we listen to them ourselves. Otherwise moving such an item within
+// the same window would leave us in the tree of the previous parent theme,
+// and changes of the new one would not be propagated to us.
+void PlatformTheme::watchAncestors()
+{
+    for (const auto &connection : std::as_const(d->ancestorConnections)) {
+        disconnect(connection);
+    }
+    d->ancestorConnections.clear();
+
+    // The parent theme is not attached yet while it adopts us
+    QObject *parentThemeObject = d->parentTheme ? d->parentTheme->parent() : nullptr;
+
+    QObject *candidate = parent();
+    while ((candidate = determineParent(candidate)) && candidate != parentThemeObject) {
+        if (qmlAttachedPropertiesObject<PlatformTheme>(candidate, false)) {
+            break;
+        }
+        if (auto item = qobject_cast<QQuickItem *>(candidate)) {
+            d->ancestorConnections.append(connect(item, &QQuickItem::parentChanged, this, [this]() {
+                update();
+                watchAncestors();
+            }));
+        }
     }
-    updateChildrenImpl(object->children(), updated);
 }
 
 // We sometimes set theme properties on non-visual objects. However, if an item
@@ -1173,6 +1794,13 @@ PlatformThemeChangeTracker::PlatformThemeChangeTracker(PlatformTheme *theme, Pro
     if (itr == s_blockedChanges.constEnd() || (*itr).expired()) {
         m_data = std::make_shared<Data>();
         s_blockedChanges.insert(theme, m_data);
+
+        // Changes the theme makes to its own data while tracked are applied
+        // and sent to the watchers in one go once tracking ends.
+        if (theme->d->data && theme->d->data->owner == theme) {
+            m_data->transaction = theme->d->data;
+            m_data->transaction->beginTransaction();
+        }
     } else {
         m_data = (*itr).lock();
     }
@@ -1184,6 +1812,21 @@ PlatformThemeChangeTracker::~PlatformThemeChangeTracker() noexcept
 {
     std::weak_ptr<Data> dataWatcher = m_data;
 
+    if (m_data.use_count() == 1) {
+        // Committing notifies m_theme as well, which is still tracked here so
+        // that its signals are only emitted once, below.
+        if (m_data->transaction) {
+            std::exchange(m_data->transaction, nullptr)->commitTransaction();
+        }
+
+        // The implementation has applied the change by now. Joining other
+        // data makes it sync once more, which may open another transaction.
+        m_theme->d->internData(m_theme);
+        if (m_data->transaction) {
+            std::exchange(m_data->transaction, nullptr)->commitTransaction();
+        }
+    }
+
     auto changes = m_data->changes;
     m_data.reset();
 
@@ -553,6 +553,19 @@ public:
      */
     virtual Q_INVOKABLE QIcon iconFromTheme(const QString &name, const QColor &customColor = Qt::transparent);
 
+    /*!
+     * Returns iconFromTheme(\a name, \a customColor), reusing the icon
+     * returned earlier for the same name and color by any theme of the same
+     * implementation and palette while the icon theme stays the same.
+     *
+     * Icons looked up this way share one icon engine, so they are only
+     * loaded and recolored once. The most recently used 256 icons are kept.
+     * Themes with custom colors set always call iconFromTheme().
+     *
+     * \since 6.30
+     */
+    QIcon cachedIconFromTheme(const QString &name, const QColor &customColor = Qt::transparent);
+
     bool supportsIconColoring() const;
 
     // foreground colors
@@ -589,6 +602,19 @@ public:
     // QML attached property
     static PlatformTheme *qmlAttachedProperties(QObject *object);
 
+    /*!
+     * Returns the number of distinct blocks of color and font data used by
+     * all themes of the application.
+     *
+     * Themes that inherit use the data of the theme they inherit from, and
+     * themes that do not inherit but have the same implementation, colorSet,
+     * colorGroup and enabled state and no custom colors share data as well.
+     * This is meant for debugging memory use.
+     *
+     * \since 6.30
+     */
+    static int dataBlockCount();
+
 Q_SIGNALS:
     void colorsChanged();
     void defaultFontChanged(const QFont &font);
@@ -643,7 +669,10 @@ protected:
 
 private:
     KIRIGAMIPLATFORM_NO_EXPORT void update();
-    KIRIGAMIPLATFORM_NO_EXPORT void updateChildren(QObject *item);
+    KIRIGAMIPLATFORM_NO_EXPORT void scheduleChildUpdate();
+    KIRIGAMIPLATFORM_NO_EXPORT void updateChildren();
+    KIRIGAMIPLATFORM_NO_EXPORT PlatformTheme *findParentTheme();
+    KIRIGAMIPLATFORM_NO_EXPORT void watchAncestors();
     KIRIGAMIPLATFORM_NO_EXPORT QObject *determineParent(QObject *object);
     KIRIGAMIPLATFORM_NO_EXPORT void emitSignalsForChanges(int changes);
 
@@ -664,6 +693,10 @@ private:
  * things making use of PlatformTheme aren't needlessly redrawn or redrawn in a
  * partially changed state.
  *
+ * Changes a theme makes to its own colors, fonts, color set and color group
+ * while it is tracked are also delivered as a single batch to the themes
+ * inheriting from it once the outermost tracker is destroyed.
+ *
  * \since 6.7
  *
  */
@@ -712,11 +745,16 @@ private:
     // hash using the PlatformTheme as key.
     struct Data {
         PropertyChanges changes;
+        // Theme data owned by the tracked theme, with a transaction open
+        // while the outermost tracker exists.
+        std::shared_ptr<PlatformThemeData> transaction;
     };
 
     std::shared_ptr<Data> m_data;
 
     inline static QHash<PlatformTheme *, std::weak_ptr<Data>> s_blockedChanges;
+
+    friend class PlatformThemePrivate;
 };
 
 namespace PlatformThemeEvents
@@ -0,0 +1,82 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "systemfonts_p.h"
+
+#include <QFontDatabase>
+#include <QGuiApplication>
+
+namespace Kirigami
+{
+namespace Platform
+{
+
+Q_GLOBAL_STATIC(SystemFonts, systemFontsInstance)
+
+SystemFonts::SystemFonts(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SystemFonts *SystemFonts::instance()
+{
+    auto fonts = systemFontsInstance();
+    // The cache can be used before the application exists, it only starts
+    // following font changes once there is one. Whatever was resolved before
+    // that may not match the application's fonts.
+    if (!fonts->m_filterInstalled && qGuiApp) {
+        qGuiApp->installEventFilter(fonts);
+        fonts->m_filterInstalled = true;
+        fonts->m_defaultFont.reset();
+        fonts->m_smallFont.reset();
+        fonts->m_fixedWidthFont.reset();
+    }
+    return fonts;
+}
+
+QFont SystemFonts::defaultFont()
+{
+    auto fonts = instance();
+    if (!fonts->m_defaultFont) {
+        fonts->m_defaultFont = QGuiApplication::font();
+    }
+    return *fonts->m_defaultFont;
+}
+
+QFont SystemFonts::smallFont()
+{
+    auto fonts = instance();
+    if (!fonts->m_smallFont) {
+        fonts->m_smallFont = QFontDatabase::systemFont(QFontDatabase::SmallestReadableFont);
+    }
+    return *fonts->m_smallFont;
+}
+
+QFont SystemFonts::fixedWidthFont()
+{
+    auto fonts = instance();
+    if (!fonts->m_fixedWidthFont) {
+        fonts->m_fixedWidthFont = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    }
+    return *fonts->m_fixedWidthFont;
+}
+
+bool SystemFonts::eventFilter(QObject *watched, QEvent *event)
+{
+    // Platform themes also send this when the system fonts change
+    if (event->type() == QEvent::ApplicationFontChange && watched == qGuiApp) {
+        m_defaultFont.reset();
+        m_smallFont.reset();
+        m_fixedWidthFont.reset();
+        Q_EMIT changed();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+}
+}
+
+#include "moc_systemfonts_p.cpp"
@@ -0,0 +1,62 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#ifndef SYSTEMFONTS_P_H
+#define SYSTEMFONTS_P_H
+
+#include <QFont>
+#include <QObject>
+
+#include <optional>
+
+namespace Kirigami
+{
+namespace Platform
+{
+
+/*
+ * Process-wide cache of the fonts themes and units start from.
+ *
+ * QFontDatabase::systemFont() asks the platform theme, and through it usually
+ * fontconfig, every time it is called. Every theme that does not inherit
+ * creates its own data and needs these fonts, so they are resolved once here
+ * and handed out as implicitly shared copies until the application font
+ * changes.
+ */
+class SystemFonts : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SystemFonts(QObject *parent = nullptr);
+
+    static SystemFonts *instance();
+
+    // QGuiApplication::font()
+    static QFont defaultFont();
+    // QFontDatabase::SmallestReadableFont
+    static QFont smallFont();
+    // QFontDatabase::FixedFont
+    static QFont fixedWidthFont();
+
+    // Emitted after the cached fonts were dropped because the application
+    // font changed.
+    Q_SIGNAL void changed();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    std::optional<QFont> m_defaultFont;
+    std::optional<QFont> m_smallFont;
+    std::optional<QFont> m_fixedWidthFont;
+    bool m_filterInstalled = false;
+};
+
+}
+}
+
+#endif // SYSTEMFONTS_P_H
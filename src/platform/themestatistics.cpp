@@ -0,0 +1,141 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "themestatistics.h"
+#include "platformtheme.h"
+#include "themestatistics_p.h"
+
+#include <QCoreApplication>
+#include <QJSEngine>
+
+#include <algorithm>
+
+#include "themestatistics_logging.h"
+
+namespace Kirigami
+{
+namespace Platform
+{
+
+bool ThemeStatisticsPrivate::isEnabled()
+{
+    static const bool enabled = KirigamiThemeStatistics().isDebugEnabled();
+    return enabled;
+}
+
+void ThemeStatisticsPrivate::countPropagation(qint64 nsecs)
+{
+    ++s_propagations;
+
+    const qint64 usecs = nsecs / 1000;
+    auto bucket = std::upper_bound(s_bucketLimits.begin(), s_bucketLimits.end(), usecs);
+    ++s_propagationHistogram[std::distance(s_bucketLimits.begin(), bucket)];
+}
+
+ThemeStatistics::ThemeStatistics(QObject *parent)
+    : QObject(parent)
+    , d(std::make_unique<ThemeStatisticsPrivate>())
+{
+    d->sinceRefresh.start();
+}
+
+ThemeStatistics::~ThemeStatistics() = default;
+
+ThemeStatistics *ThemeStatistics::instance()
+{
+    static ThemeStatistics *instance = new ThemeStatistics(qApp);
+    return instance;
+}
+
+ThemeStatistics *ThemeStatistics::create(QQmlEngine *qmlEngine, QJSEngine *jsEngine)
+{
+    Q_UNUSED(qmlEngine);
+
+    // Shared by all engines
+    auto statistics = instance();
+    jsEngine->setObjectOwnership(statistics, QJSEngine::CppOwnership);
+    statistics->refresh();
+    return statistics;
+}
+
+bool ThemeStatistics::isEnabled()
+{
+    return ThemeStatisticsPrivate::isEnabled();
+}
+
+int ThemeStatistics::themeCount() const
+{
+    return d->themeCount;
+}
+
+int ThemeStatistics::dataBlockCount() const
+{
+    return d->dataBlockCount;
+}
+
+int ThemeStatistics::sharedDataBlockCount() const
+{
+    return d->sharedDataBlockCount;
+}
+
+qreal ThemeStatistics::sharingRatio() const
+{
+    return d->dataBlockCount > 0 ? qreal(d->themeCount) / d->dataBlockCount : 0.0;
+}
+
+qint64 ThemeStatistics::notificationCount() const
+{
+    return d->notificationCount;
+}
+
+qreal ThemeStatistics::notificationsPerSecond() const
+{
+    return d->notificationsPerSecond;
+}
+
+qint64 ThemeStatistics::propagationCount() const
+{
+    return d->propagationCount;
+}
+
+QList<qint64> ThemeStatistics::propagationHistogram() const
+{
+    return d->propagationHistogram;
+}
+
+QList<qint64> ThemeStatistics::propagationBucketLimits() const
+{
+    const auto &limits = ThemeStatisticsPrivate::s_bucketLimits;
+    return QList<qint64>(limits.begin(), limits.end());
+}
+
+void ThemeStatistics::refresh()
+{
+    const qint64 elapsed = d->sinceRefresh.restart();
+    const qint64 notifications = ThemeStatisticsPrivate::s_notifications;
+    d->notificationsPerSecond = elapsed > 0 ? (notifications - d->notificationCount) * 1000.0 / elapsed : 0.0;
+
+    d->themeCount = ThemeStatisticsPrivate::s_themes;
+    d->dataBlockCount = PlatformTheme::dataBlockCount();
+    d->sharedDataBlockCount = ThemeStatisticsPrivate::s_sharedDataBlocks;
+    d->notificationCount = notifications;
+    d->propagationCount = ThemeStatisticsPrivate::s_propagations;
+
+    const auto &histogram = ThemeStatisticsPrivate::s_propagationHistogram;
+    std::copy(histogram.begin(), histogram.end(), d->propagationHistogram.begin());
+
+    qCDebug(KirigamiThemeStatistics).nospace() << d->themeCount << " themes, " //
+                                               << d->dataBlockCount << " data blocks (" << d->sharedDataBlockCount << " shared), " //
+                                               << d->notificationCount << " notifications (" << d->notificationsPerSecond << "/s), " //
+                                               << d->propagationCount << " propagations " << d->propagationHistogram;
+
+    Q_EMIT refreshed();
+}
+
+}
+}
+
+#include "moc_themestatistics.cpp"
@@ -0,0 +1,173 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#ifndef KIRIGAMI_PLATFORM_THEMESTATISTICS_H
+#define KIRIGAMI_PLATFORM_THEMESTATISTICS_H
+
+#include <QList>
+#include <QObject>
+#include <qqmlregistration.h>
+
+#include <memory>
+
+#include "kirigamiplatform_export.h"
+
+class QQmlEngine;
+class QJSEngine;
+
+namespace Kirigami
+{
+namespace Platform
+{
+class ThemeStatisticsPrivate;
+
+/*!
+ * \qmltype ThemeStatistics
+ * \inqmlmodule org.kde.kirigami.platform
+ *
+ * \nativetype Kirigami::Platform::ThemeStatistics
+ *
+ * \brief Counters of the theme system, for debugging.
+ *
+ * The properties hold a snapshot taken by the last call to refresh(). The
+ * instance counts are always available. Notifications and propagations are
+ * only counted while the kf.kirigami.platform.themestatistics logging category
+ * is enabled for debug output, e.g. with
+ * QT_LOGGING_RULES="kf.kirigami.platform.themestatistics.debug=true". Each
+ * refresh() is logged to that category as well.
+ */
+
+/*!
+ * \class Kirigami::Platform::ThemeStatistics
+ * \inheaderfile Kirigami/Platform/ThemeStatistics
+ * \inmodule KirigamiPlatform
+ *
+ * \brief Counters of the theme system, for debugging.
+ *
+ * See the QML type for details. The same instance is used by C++ and all QML
+ * engines.
+ *
+ * \since 6.30
+ */
+class KIRIGAMIPLATFORM_EXPORT ThemeStatistics : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+
+    /*!
+     * \qmlproperty bool ThemeStatistics::enabled
+     *
+     * Whether notifications and propagations are counted.
+     */
+    Q_PROPERTY(bool enabled READ isEnabled CONSTANT FINAL)
+
+    /*!
+     * \qmlproperty int ThemeStatistics::themeCount
+     *
+     * The number of attached Theme objects alive.
+     */
+    Q_PROPERTY(int themeCount READ themeCount NOTIFY refreshed FINAL)
+
+    /*!
+     * \qmlproperty int ThemeStatistics::dataBlockCount
+     *
+     * The number of distinct blocks of theme data alive, see
+     * PlatformTheme::dataBlockCount().
+     */
+    Q_PROPERTY(int dataBlockCount READ dataBlockCount NOTIFY refreshed FINAL)
+
+    /*!
+     * \qmlproperty int ThemeStatistics::sharedDataBlockCount
+     *
+     * How many of the data blocks are shared by themes that do not inherit.
+     */
+    Q_PROPERTY(int sharedDataBlockCount READ sharedDataBlockCount NOTIFY refreshed FINAL)
+
+    /*!
+     * \qmlproperty real ThemeStatistics::sharingRatio
+     *
+     * The average number of themes per data block.
+     */
+    Q_PROPERTY(qreal sharingRatio READ sharingRatio NOTIFY refreshed FINAL)
+
+    /*!
+     * \qmlproperty double ThemeStatistics::notificationCount
+     *
+     * The number of change events sent to themes by their data. A 64 bit
+     * integer, which QML represents as a double.
+     */
+    Q_PROPERTY(qint64 notificationCount READ notificationCount NOTIFY refreshed FINAL)
+
+    /*!
+     * \qmlproperty real ThemeStatistics::notificationsPerSecond
+     *
+     * The rate of change events since the previous refresh().
+     */
+    Q_PROPERTY(qreal notificationsPerSecond READ notificationsPerSecond NOTIFY refreshed FINAL)
+
+    /*!
+     * \qmlproperty double ThemeStatistics::propagationCount
+     *
+     * How often a change was propagated to inheriting themes. A 64 bit
+     * integer, which QML represents as a double.
+     */
+    Q_PROPERTY(qint64 propagationCount READ propagationCount NOTIFY refreshed FINAL)
+
+    /*!
+     * \qmlproperty list<double> ThemeStatistics::propagationHistogram
+     *
+     * The number of propagations by duration. Entry i counts the propagations
+     * that took less than propagationBucketLimits[i] microseconds, and no less
+     * than the limit before it. The last entry counts all longer ones.
+     */
+    Q_PROPERTY(QList<qint64> propagationHistogram READ propagationHistogram NOTIFY refreshed FINAL)
+
+    /*!
+     * \qmlproperty list<double> ThemeStatistics::propagationBucketLimits
+     *
+     * The upper limits, in microseconds, of the entries of propagationHistogram.
+     */
+    Q_PROPERTY(QList<qint64> propagationBucketLimits READ propagationBucketLimits CONSTANT FINAL)
+
+public:
+    ~ThemeStatistics() override;
+
+    static ThemeStatistics *instance();
+    static ThemeStatistics *create(QQmlEngine *qmlEngine, QJSEngine *jsEngine);
+
+    static bool isEnabled();
+
+    int themeCount() const;
+    int dataBlockCount() const;
+    int sharedDataBlockCount() const;
+    qreal sharingRatio() const;
+    qint64 notificationCount() const;
+    qreal notificationsPerSecond() const;
+    qint64 propagationCount() const;
+    QList<qint64> propagationHistogram() const;
+    QList<qint64> propagationBucketLimits() const;
+
+    /*!
+     * \qmlmethod void ThemeStatistics::refresh()
+     *
+     * Takes a new snapshot of the counters.
+     */
+    Q_INVOKABLE void refresh();
+
+Q_SIGNALS:
+    void refreshed();
+
+private:
+    explicit ThemeStatistics(QObject *parent = nullptr);
+
+    const std::unique_ptr<ThemeStatisticsPrivate> d;
+};
+
+}
+}
+
+#endif // KIRIGAMI_PLATFORM_THEMESTATISTICS_H
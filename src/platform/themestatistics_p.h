@@ -0,0 +1,65 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#ifndef THEMESTATISTICS_P_H
+#define THEMESTATISTICS_P_H
+
+#include <QElapsedTimer>
+#include <QList>
+
+#include <array>
+
+namespace Kirigami
+{
+namespace Platform
+{
+
+/*
+ * The counters behind ThemeStatistics, updated by PlatformTheme, and the
+ * snapshot of them the instance exposes. Only used on the GUI thread.
+ */
+class ThemeStatisticsPrivate
+{
+public:
+    // Whether the logging category is enabled, checked once
+    static bool isEnabled();
+
+    static void countNotification()
+    {
+        if (isEnabled()) {
+            ++s_notifications;
+        }
+    }
+
+    static void countPropagation(qint64 nsecs);
+
+    // Upper limits of the histogram buckets in microseconds, the last bucket
+    // has no limit.
+    static constexpr std::array<qint64, 5> s_bucketLimits{10, 100, 1000, 10000, 100000};
+
+    // Cheap enough to always be counted
+    inline static int s_themes = 0;
+    inline static int s_sharedDataBlocks = 0;
+
+    inline static qint64 s_notifications = 0;
+    inline static qint64 s_propagations = 0;
+    inline static std::array<qint64, s_bucketLimits.size() + 1> s_propagationHistogram{};
+
+    // Taken by ThemeStatistics::refresh()
+    int themeCount = 0;
+    int dataBlockCount = 0;
+    int sharedDataBlockCount = 0;
+    qint64 notificationCount = 0;
+    qreal notificationsPerSecond = 0.0;
+    qint64 propagationCount = 0;
+    QList<qint64> propagationHistogram = QList<qint64>(qsizetype(s_propagationHistogram.size()));
+    QElapsedTimer sinceRefresh;
+};
+
+}
+}
+
+#endif // THEMESTATISTICS_P_H
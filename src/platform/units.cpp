@@ -19,6 +19,7 @@
 
 #include "kirigamiplatform_logging.h"
 #include "platformpluginfactory.h"
+#include "systemfonts_p.h"
 
 namespace Kirigami
 {
@@ -32,7 +33,7 @@ class UnitsPrivate
 public:
     explicit UnitsPrivate(Units *units)
         // Cache font so we don't have to go through QVariant and property every time
-        : fontMetrics(QFontMetricsF(QGuiApplication::font()))
+        : fontMetrics(QFontMetricsF(SystemFonts::defaultFont()))
         , gridUnit(18)
         , smallSpacing(4)
         , mediumSpacing(6)
@@ -79,7 +80,17 @@ Units::Units(QObject *parent)
     : QObject(parent)
     , d(std::make_unique<UnitsPrivate>(this))
 {
-    qGuiApp->installEventFilter(this);
+    // Not an event filter of our own: filters run in reverse order of
+    // installation, so ours could run before the cache was invalidated.
+    connect(SystemFonts::instance(), &SystemFonts::changed, this, [this]() {
+        d->fontMetrics = QFontMetricsF(SystemFonts::defaultFont());
+
+        if (d->customUnitsSet) {
+            return;
+        }
+
+        Q_EMIT d->iconSizes->sizeForLabelsChanged();
+    });
 }
 
 int Units::gridUnit() const
@@ -269,18 +280,11 @@ Units *Units::create(QQmlEngine *qmlEngine, [[maybe_unused]] QJSEngine *jsEngine
     return new Units(qmlEngine);
 }
 
-bool Units::eventFilter([[maybe_unused]] QObject *watched, QEvent *event)
+// TODO KF7: Remove, only kept for binary compatibility. Font changes are
+// followed through SystemFonts::changed.
+bool Units::eventFilter(QObject *watched, QEvent *event)
 {
-    if ((event->type() == QEvent::ApplicationFontChange) && (watched == qGuiApp)) {
-        d->fontMetrics = QFontMetricsF(qGuiApp->font());
-
-        if (d->customUnitsSet) {
-            return false;
-        }
-
-        Q_EMIT d->iconSizes->sizeForLabelsChanged();
-    }
-    return false;
+    return QObject::eventFilter(watched, event);
 }
 
 IconSizes *Units::iconSizes() const
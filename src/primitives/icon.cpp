@@ -6,6 +6,9 @@
  */
 
 #include "icon.h"
+#include "iconimagecache.h"
+#include "iconimageloader.h"
+#include "scenegraph/iconatlas.h"
 #include "scenegraph/iconnode.h"
 #include "scenegraph/shadernode.h"
 #include "scenegraph/softwarerectanglenode.h"
@@ -15,18 +18,21 @@
 
 #include <QBitmap>
 #include <QDebug>
+#include <QDir>
 #include <QGuiApplication>
 #include <QIcon>
-#include <QNetworkReply>
 #include <QPainter>
-#include <QPropertyAnimation>
 #include <QQuickImageProvider>
 #include <QQuickWindow>
 #include <QSGTexture>
 #include <QScreen>
+#include <QTimer>
 
 using namespace Qt::StringLiterals;
 
+// How long to wait again for a blend that is not done when it should be
+static constexpr int s_animationFrameSlack = 16;
+
 Icon::Icon(QQuickItem *parent)
     : QQuickItem(parent)
     , m_active(false)
@@ -55,19 +61,20 @@ void Icon::componentComplete()
     Q_ASSERT(engine);
     m_units = engine->singletonInstance<Kirigami::Platform::Units *>("org.kde.kirigami.platform", "Units");
     Q_ASSERT(m_units);
-    m_animation = new QPropertyAnimation(this);
-    connect(m_animation, &QPropertyAnimation::valueChanged, this, &Icon::valueChanged);
-    connect(m_animation, &QPropertyAnimation::finished, this, [this]() {
+    // The blend itself runs on the render thread, see IconNode
+    m_animationTimer = new QTimer(this);
+    m_animationTimer->setSingleShot(true);
+    connect(m_animationTimer, &QTimer::timeout, this, [this]() {
+        // The node only starts blending with the first frame rendered after
+        // this timer was started, keep the old image until it is done.
+        if (!*m_animationFinished && isVisible() && window() && window()->isExposed()) {
+            m_animationTimer->start(s_animationFrameSlack);
+            return;
+        }
         m_oldIcon = QImage();
         m_textureChanged = true;
         update();
     });
-    m_animation->setTargetObject(this);
-    m_animation->setEasingCurve(QEasingCurve::InOutCubic);
-    m_animation->setDuration(m_units->longDuration());
-    connect(m_units, &Kirigami::Platform::Units::longDurationChanged, m_animation, [this]() {
-        m_animation->setDuration(m_units->longDuration());
-    });
     updatePaintedGeometry();
 }
 
@@ -85,10 +92,6 @@ void Icon::setSource(const QVariant &icon)
         connect(m_theme, &Kirigami::Platform::PlatformTheme::colorsChanged, this, &QQuickItem::polish);
     }
 
-    if (m_networkReply) {
-        // if there was a network query going on, interrupt it
-        m_networkReply->close();
-    }
     m_loadedImage = QImage();
     setStatus(Loading);
 
@@ -225,15 +228,27 @@ QSGNode *Icon::updatePaintNode(QSGNode *node, QQuickItem::UpdatePaintNodeData *
 
     UniformDataStream stream(shaderNode->uniformData());
     stream.skipMatrixOpacity();
-    stream << float(m_animValue) // mix_amount
-           << (m_active ? 0.7f : 0.0f) // highlight_amount
+    if (shaderNode->isAnimating()) {
+        // Written by the node on every frame of the blend, resetting it here would flash the new icon
+        stream.skip<float>(); // mix_amount
+    } else {
+        stream << 1.0f; // mix_amount
+    }
+    stream << (m_active ? 0.7f : 0.0f) // highlight_amount
            << (isEnabled() ? 0.0f : 1.0f) // desaturate_amount
            << ShaderNode::toPremultiplied(maskColor); // mask_color
 
-    shaderNode->setTexture(0, m_icon, window(), QQuickWindow::TextureCanUseAtlas);
+    shaderNode->setTexture(0, IconAtlas::loadTexture(window(), m_icon));
 
     if (shouldBeAnimated) {
-        shaderNode->setTexture(1, m_oldIcon, window(), QQuickWindow::TextureCanUseAtlas);
+        shaderNode->setTexture(1, IconAtlas::loadTexture(window(), m_oldIcon));
+    }
+
+    if (shouldBeAnimated && m_animationStarted) {
+        shaderNode->startMixAnimation(window(), m_animationTimer->interval(), QEasingCurve::InOutCubic, m_animationFinished);
+        m_animationStarted = false;
+    } else if (!m_animationTimer || !m_animationTimer->isActive()) {
+        shaderNode->stopMixAnimation();
     }
 
     shaderNode->setRect(calculateNodeRect());
@@ -252,53 +267,6 @@ void Icon::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
     }
 }
 
-void Icon::handleRedirect(QNetworkReply *reply)
-{
-    QNetworkAccessManager *qnam = reply->manager();
-    if (reply->error() != QNetworkReply::NoError) {
-        return;
-    }
-    const QUrl possibleRedirectUrl = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
-    if (!possibleRedirectUrl.isEmpty()) {
-        const QUrl redirectUrl = reply->url().resolved(possibleRedirectUrl);
-        if (redirectUrl == reply->url()) {
-            // no infinite redirections thank you very much
-            reply->deleteLater();
-            return;
-        }
-        reply->deleteLater();
-        QNetworkRequest request(possibleRedirectUrl);
-        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
-        m_networkReply = qnam->get(request);
-        connect(m_networkReply.data(), &QNetworkReply::finished, this, [this]() {
-            handleFinished(m_networkReply);
-        });
-    }
-}
-
-void Icon::handleFinished(QNetworkReply *reply)
-{
-    if (!reply) {
-        return;
-    }
-
-    reply->deleteLater();
-    if (!reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isNull()) {
-        handleRedirect(reply);
-        return;
-    }
-
-    m_loadedImage = QImage();
-
-    const QString filename = reply->url().fileName();
-    if (!m_loadedImage.load(reply, filename.mid(filename.indexOf(QLatin1Char('.'))).toLatin1().constData())) {
-        // broken image from data, inform the user of this with some useful broken-image thing...
-        m_loadedImage = iconPixmap(QIcon::fromTheme(m_fallback));
-    }
-
-    polish();
-}
-
 void Icon::updatePolish()
 {
     QQuickItem::updatePolish();
@@ -318,8 +286,8 @@ void Icon::updatePolish()
     if (itemSize.width() != 0 && itemSize.height() != 0) {
         const QSize size = itemSize;
 
-        if (m_animation) {
-            m_animation->stop();
+        if (m_animationTimer) {
+            m_animationTimer->stop();
             m_oldIcon = m_icon;
         }
 
@@ -360,16 +328,15 @@ void Icon::updatePolish()
     // don't animate initial setting
     bool animated = m_animated && !m_oldIcon.isNull() && !m_sizeChanged && !m_blockNextAnimation && !isSoftwareRendering();
 
-    if (animated && m_animation) {
-        m_animValue = 0.0;
-        m_animation->setStartValue((qreal)0);
-        m_animation->setEndValue((qreal)1);
-        m_animation->start();
+    if (animated && m_animationTimer) {
+        *m_animationFinished = false;
+        m_animationTimer->start(m_units->longDuration());
+        m_animationStarted = true;
     } else {
-        if (m_animation) {
-            m_animation->stop();
+        if (m_animationTimer) {
+            m_animationTimer->stop();
         }
-        m_animValue = 1.0;
+        m_animationStarted = false;
         m_blockNextAnimation = false;
     }
     m_textureChanged = true;
@@ -459,23 +426,19 @@ QImage Icon::findIcon(const QSize &size)
             break;
         }
     } else if (iconSource.startsWith(QLatin1String("http://")) || iconSource.startsWith(QLatin1String("https://"))) {
-        if (!m_loadedImage.isNull()) {
-            setStatus(Ready);
-            return m_loadedImage.scaled(size, Qt::KeepAspectRatio, smooth() ? Qt::SmoothTransformation : Qt::FastTransformation);
-        }
-        const auto url = m_source.toUrl();
+        // Downloaded once for all instances, decoded at this size on a worker thread
         QQmlEngine *engine = qmlEngine(this);
-        QNetworkAccessManager *qnam;
-        if (engine && (qnam = engine->networkAccessManager()) && (!m_networkReply || m_networkReply->url() != url)) {
-            QNetworkRequest request(url);
-            request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
-            m_networkReply = qnam->get(request);
-            connect(m_networkReply.data(), &QNetworkReply::finished, this, [this]() {
-                handleFinished(m_networkReply);
-            });
+        if (QNetworkAccessManager *manager = engine ? engine->networkAccessManager() : nullptr) {
+            const QUrl url = m_source.toUrl();
+            const IconImageCache::Key key{url.toString(), 0, size, m_devicePixelRatio, QIcon::Normal};
+            img = loadAsynchronously(
+                key,
+                [manager, url](const IconImageCache::Key &imageKey) {
+                    return IconImageLoader::loadRemote(manager, url, imageKey);
+                },
+                // Temporary icon while we wait for the real image to load...
+                iconPixmap(QIcon::fromTheme(m_placeholder)));
         }
-        // Temporary icon while we wait for the real image to load...
-        img = iconPixmap(QIcon::fromTheme(m_placeholder));
     } else {
         if (iconSource.startsWith(QLatin1String("qrc:/"))) {
             iconSource = iconSource.mid(3);
@@ -483,10 +446,15 @@ QImage Icon::findIcon(const QSize &size)
             iconSource = QUrl(iconSource).toLocalFile();
         }
 
-        const QIcon icon = loadFromTheme(iconSource);
-
-        if (!icon.isNull()) {
-            img = iconPixmap(icon);
+        if (canLoadAsynchronously(iconSource)) {
+            const IconImageCache::Key key{u"file:"_s + iconSource, 0, iconSizeHint(), m_devicePixelRatio, QIcon::Normal};
+            img = loadAsynchronously(key, [iconSource](const IconImageCache::Key &imageKey) {
+                return IconImageLoader::load(imageKey, [iconSource, imageKey]() {
+                    return IconImageLoader::decodeFile(iconSource, imageKey.size, imageKey.devicePixelRatio);
+                });
+            });
+        } else if (const QIcon icon = loadFromTheme(iconSource); !icon.isNull()) {
+            img = iconPixmap(icon, true);
             setStatus(Ready);
         }
     }
@@ -563,6 +531,11 @@ QSize Icon::iconSizeHint() const
 }
 
 QImage Icon::iconPixmap(const QIcon &icon) const
+{
+    return iconPixmap(icon, false);
+}
+
+QImage Icon::iconPixmap(const QIcon &icon, bool themed) const
 {
     const QSize actualSize = icon.actualSize(iconSizeHint());
     QIcon sourceIcon = icon;
@@ -570,10 +543,11 @@ QImage Icon::iconPixmap(const QIcon &icon) const
     // if we have a non-default theme we need to load the icon with
     // the right colors
     const QQmlEngine *engine = qmlEngine(this);
-    if (engine && !engine->property("_kirigamiTheme").toString().isEmpty()) {
+    if (!themed && engine && !engine->property("_kirigamiTheme").toString().isEmpty()) {
         const QString iconName = icon.name();
         if (!iconName.isEmpty() && QIcon::hasThemeIcon(iconName)) {
             sourceIcon = loadFromTheme(iconName);
+            themed = true;
         }
     }
 
@@ -585,13 +559,70 @@ QImage Icon::iconPixmap(const QIcon &icon) const
             mode = QIcon::Mode::Active;
         }
     }
-    return sourceIcon.pixmap(actualSize, m_devicePixelRatio, mode, QIcon::On).toImage();
+
+    // Delegates tend to show the same icons at the same size, share the
+    // rendered image with them.
+    const auto key = IconImageCache::keyForIcon(sourceIcon, themed, actualSize, m_devicePixelRatio, mode);
+    if (auto image = IconImageCache::find(key)) {
+        return *image;
+    }
+
+    const QImage image = sourceIcon.pixmap(actualSize, m_devicePixelRatio, mode, QIcon::On).toImage();
+    IconImageCache::insert(key, image);
+    return image;
+}
+
+bool Icon::canLoadAsynchronously(const QString &path) const
+{
+    if (!m_asynchronous || isSoftwareRendering() || !(path.startsWith(u":/") || QDir::isAbsolutePath(path))) {
+        return false;
+    }
+
+    // Platform themes may recolor image files as well, which needs the GUI thread
+    const QQmlEngine *engine = qmlEngine(this);
+    return !engine || engine->property("_kirigamiTheme").toString().isEmpty();
+}
+
+QImage Icon::loadAsynchronously(const IconImageCache::Key &key, const std::function<QFuture<QImage>(const IconImageCache::Key &)> &load, const QImage &placeholder)
+{
+    if (m_asyncKey == key && m_asyncWatcher->isFinished()) {
+        const QImage image = m_asyncWatcher->result();
+        if (!image.isNull()) {
+            setStatus(Ready);
+        }
+        // A null image makes findIcon() show the fallback
+        return image;
+    }
+
+    if (auto image = IconImageCache::find(key)) {
+        setStatus(Ready);
+        return *image;
+    }
+
+    if (m_asyncKey != key) {
+        if (!m_asyncWatcher) {
+            m_asyncWatcher = new QFutureWatcher<QImage>(this);
+            connect(m_asyncWatcher, &QFutureWatcherBase::finished, this, &QQuickItem::polish);
+        }
+        m_asyncKey = key;
+        m_asyncWatcher->setFuture(load(key));
+    }
+
+    setStatus(Loading);
+    if (!placeholder.isNull()) {
+        return placeholder;
+    }
+
+    QImage transparent(key.size * key.devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    transparent.fill(Qt::transparent);
+    transparent.setDevicePixelRatio(key.devicePixelRatio);
+    return transparent;
 }
 
 QIcon Icon::loadFromTheme(const QString &iconName) const
 {
     const QColor tintColor = !m_color.isValid() || m_color == Qt::transparent ? (m_selected ? m_theme->highlightedTextColor() : m_theme->textColor()) : m_color;
-    return m_theme->iconFromTheme(iconName, tintColor);
+    return m_theme->cachedIconFromTheme(iconName, tintColor);
 }
 
 void Icon::updatePaintedGeometry()
@@ -661,6 +692,22 @@ void Icon::setAnimated(bool animated)
     Q_EMIT animatedChanged();
 }
 
+bool Icon::isAsynchronous() const
+{
+    return m_asynchronous;
+}
+
+void Icon::setAsynchronous(bool asynchronous)
+{
+    if (m_asynchronous == asynchronous) {
+        return;
+    }
+
+    m_asynchronous = asynchronous;
+    polish();
+    Q_EMIT asynchronousChanged();
+}
+
 bool Icon::roundToIconSize() const
 {
     return m_roundToIconSize;
@@ -708,12 +755,6 @@ void Icon::itemChange(QQuickItem::ItemChange change, const QQuickItem::ItemChang
     QQuickItem::itemChange(change, value);
 }
 
-void Icon::valueChanged(const QVariant &value)
-{
-    m_animValue = value.toReal();
-    update();
-}
-
 void Icon::windowVisibleChanged(bool visible)
 {
     if (visible) {
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <QFutureWatcher>
 #include <QIcon>
 #include <QPointer>
 #include <QQuickItem>
@@ -15,9 +16,15 @@
 
 #include <QQmlEngine>
 
-class QNetworkReply;
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "iconimagecache.h"
+
 class QQuickWindow;
-class QPropertyAnimation;
+class QTimer;
 
 namespace Kirigami
 {
@@ -218,6 +225,23 @@ class Icon : public QQuickItem
      */
     Q_PROPERTY(bool roundToIconSize READ roundToIconSize WRITE setRoundToIconSize NOTIFY roundToIconSizeChanged FINAL)
 
+    /*!
+     * \qmlproperty bool Icon::asynchronous
+     *
+     * If set, image files given as source by path or \c file: or \c qrc: URL
+     * are decoded on a worker thread. Until the image is ready, the icon is
+     * transparent and status is \c Loading; the image then blends in if
+     * \l animated is set.
+     *
+     * Icons from the icon theme, and any icon when a platform theme recolors
+     * icons, are always loaded synchronously.
+     *
+     * The default is \c false.
+     *
+     * \since 6.30
+     */
+    Q_PROPERTY(bool asynchronous READ isAsynchronous WRITE setAsynchronous NOTIFY asynchronousChanged FINAL)
+
 public:
     /*!
      * \value Null No icon has been set
@@ -272,6 +296,9 @@ public:
     bool roundToIconSize() const;
     void setRoundToIconSize(bool roundToIconSize);
 
+    bool isAsynchronous() const;
+    void setAsynchronous(bool asynchronous);
+
     QSGNode *updatePaintNode(QSGNode *node, UpdatePaintNodeData *data) override;
 
 Q_SIGNALS:
@@ -287,12 +314,11 @@ Q_SIGNALS:
     void paintedAreaChanged();
     void animatedChanged();
     void roundToIconSizeChanged();
+    void asynchronousChanged();
 
 protected:
     void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
     QImage findIcon(const QSize &size);
-    void handleFinished(QNetworkReply *reply);
-    void handleRedirect(QNetworkReply *reply);
     bool guessMonochrome(const QImage &img);
     void setStatus(Status status);
     void updatePolish() override;
@@ -301,19 +327,25 @@ protected:
     void itemChange(QQuickItem::ItemChange change, const QQuickItem::ItemChangeData &value) override;
 
 private:
-    void valueChanged(const QVariant &value);
     void windowVisibleChanged(bool visible);
     QSGNode *createSubtree(qreal initialOpacity);
     void updateSubtree(QSGNode *node, qreal opacity);
     QSize iconSizeHint() const;
     inline QImage iconPixmap(const QIcon &icon) const;
+    // themed: icon was returned by loadFromTheme()
+    QImage iconPixmap(const QIcon &icon, bool themed) const;
     QIcon loadFromTheme(const QString &iconName) const;
+    bool canLoadAsynchronously(const QString &path) const;
+    // Starts @p load unless an image for @p key is available, shows @p placeholder
+    // or nothing until then.
+    QImage loadAsynchronously(const IconImageCache::Key &key,
+                              const std::function<QFuture<QImage>(const IconImageCache::Key &)> &load,
+                              const QImage &placeholder = QImage());
     QRectF calculateNodeRect();
     bool isSoftwareRendering() const;
 
     Kirigami::Platform::PlatformTheme *m_theme = nullptr;
     Kirigami::Platform::Units *m_units = nullptr;
-    QPointer<QNetworkReply> m_networkReply;
     QHash<int, bool> m_monochromeHeuristics;
     QVariant m_source;
     qreal m_devicePixelRatio = 1.0;
@@ -333,11 +365,19 @@ private:
     QImage m_oldIcon;
     QImage m_icon;
 
-    // animation on image change
-    QPropertyAnimation *m_animation = nullptr;
-    qreal m_animValue = 1.0;
+    // animation on image change, runs on the render thread
+    QTimer *m_animationTimer = nullptr;
+    // Set by the node once it is done blending, which it starts a frame or
+    // two after m_animationTimer
+    std::shared_ptr<std::atomic_bool> m_animationFinished = std::make_shared<std::atomic_bool>(true);
+    bool m_animationStarted = false;
     bool m_animated = false;
     bool m_roundToIconSize = true;
     bool m_blockNextAnimation = false;
+
+    // Image being decoded, or decoded, on a worker thread
+    bool m_asynchronous = false;
+    std::optional<IconImageCache::Key> m_asyncKey;
+    QFutureWatcher<QImage> *m_asyncWatcher = nullptr;
     QPointer<QQuickWindow> m_window;
 };
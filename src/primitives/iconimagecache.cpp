@@ -0,0 +1,94 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "iconimagecache.h"
+
+#include <QGuiApplication>
+#include <QMutexLocker>
+
+#include "iconimagecache_logging.h"
+
+// In KiB, the cost unit of the cache
+static constexpr qsizetype s_defaultMaxKiB = 16 * 1024;
+
+static qsizetype imageCost(const QImage &image)
+{
+    return std::max<qsizetype>(1, image.sizeInBytes() / 1024);
+}
+
+QCache<IconImageCache::Key, QImage> &IconImageCache::cache()
+{
+    static QCache<Key, QImage> cache([] {
+        bool ok = false;
+        const int size = qEnvironmentVariableIntValue("KIRIGAMI_ICON_CACHE_SIZE", &ok);
+        return ok ? qsizetype(std::max(0, size)) : s_defaultMaxKiB;
+    }());
+    return cache;
+}
+
+IconImageCache::Key IconImageCache::keyForIcon(const QIcon &icon, bool themed, QSize size, qreal devicePixelRatio, QIcon::Mode mode)
+{
+    Key key{QString(), 0, size, devicePixelRatio, mode};
+
+    // Every QIcon::fromTheme() call creates a new icon, but all of them render
+    // the same while the icon theme and the palette stay the same. Icons
+    // recolored by the platform theme are already shared per name and color.
+    if (!themed && !icon.name().isEmpty()) {
+        key.name = QIcon::themeName() + u'/' + icon.name();
+        key.mask = icon.isMask();
+        key.palette = QGuiApplication::palette().cacheKey();
+    } else {
+        key.icon = icon.cacheKey();
+    }
+    return key;
+}
+
+std::optional<QImage> IconImageCache::find(const Key &key)
+{
+    QMutexLocker locker(&s_mutex);
+    if (const QImage *image = cache().object(key)) {
+        ++s_hits;
+        return *image;
+    }
+    ++s_misses;
+    return std::nullopt;
+}
+
+void IconImageCache::insert(const Key &key, const QImage &image)
+{
+    if (image.isNull()) {
+        return;
+    }
+
+    QMutexLocker locker(&s_mutex);
+    cache().insert(key, new QImage(image), imageCost(image));
+
+    const qint64 lookups = s_hits + s_misses;
+    qCDebug(KirigamiIconImageCache).nospace() << cache().size() << " images, " //
+                                              << cache().totalCost() << "/" << cache().maxCost() << " KiB, " //
+                                              << s_hits << " hits, " << s_misses << " misses (" //
+                                              << (lookups > 0 ? s_hits * 100 / lookups : 0) << "% hit rate)";
+}
+
+void IconImageCache::setMaxBytes(qsizetype maxBytes)
+{
+    QMutexLocker locker(&s_mutex);
+    cache().setMaxCost(maxBytes / 1024);
+}
+
+void IconImageCache::clear()
+{
+    QMutexLocker locker(&s_mutex);
+    cache().clear();
+    s_hits = 0;
+    s_misses = 0;
+}
+
+IconImageCache::Statistics IconImageCache::statistics()
+{
+    QMutexLocker locker(&s_mutex);
+    return Statistics{s_hits, s_misses, cache().size(), cache().totalCost() * 1024, cache().maxCost() * 1024};
+}
@@ -0,0 +1,85 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QCache>
+#include <QIcon>
+#include <QImage>
+#include <QMutex>
+
+#include <optional>
+
+/*
+ * Process-wide cache of rasterized icons, shared by all Icon instances so
+ * that the same icon shown by many delegates is only rendered once. As the
+ * instances then hold the same QImage, IconAtlas also gives them the same
+ * texture.
+ *
+ * The cache is limited by the size of the images it holds. The limit, in
+ * KiB, can be set with the KIRIGAMI_ICON_CACHE_SIZE environment variable;
+ * 0 disables it. Its hit rate and size are logged to the
+ * kf.kirigami.primitives.iconcache category whenever an image is added, e.g.
+ * with QT_LOGGING_RULES="kf.kirigami.primitives.iconcache.debug=true".
+ */
+class IconImageCache
+{
+public:
+    struct Key {
+        // The icon theme and name for icons that have a name, the cache key of
+        // the icon otherwise.
+        QString name;
+        qint64 icon = 0;
+        QSize size;
+        qreal devicePixelRatio = 1.0;
+        QIcon::Mode mode = QIcon::Normal;
+        // What else an icon looked up by name may render differently with:
+        // icon engines recolor mask icons with the application palette.
+        bool mask = false;
+        qint64 palette = 0;
+
+        bool operator==(const Key &other) const = default;
+    };
+
+    struct Statistics {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qsizetype entries = 0;
+        qsizetype bytes = 0;
+        qsizetype maxBytes = 0;
+    };
+
+    /*
+     * @returns the key for rendering @p icon at @p size and @p devicePixelRatio.
+     *
+     * @p themed should be true for icons returned by
+     * PlatformTheme::cachedIconFromTheme(). There already is one such QIcon
+     * per name, color and palette, so they are keyed by the QIcon. Other icons
+     * that have a name, e.g. from QIcon::fromTheme(), are keyed by that name,
+     * the icon theme, whether they are a mask and the application palette.
+     * Icons without a name only match the same QIcon.
+     */
+    static Key keyForIcon(const QIcon &icon, bool themed, QSize size, qreal devicePixelRatio, QIcon::Mode mode);
+
+    static std::optional<QImage> find(const Key &key);
+    static void insert(const Key &key, const QImage &image);
+
+    static void setMaxBytes(qsizetype maxBytes);
+    static void clear();
+    static Statistics statistics();
+
+private:
+    static QCache<Key, QImage> &cache();
+
+    inline static QMutex s_mutex;
+    inline static qint64 s_hits = 0;
+    inline static qint64 s_misses = 0;
+};
+
+inline size_t qHash(const IconImageCache::Key &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.name, key.icon, key.size.width(), key.size.height(), key.devicePixelRatio, int(key.mode), key.mask, key.palette);
+}
@@ -0,0 +1,250 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "iconimageloader.h"
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QImageReader>
+#include <QMutex>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+
+// Entries are never revalidated with the server, so the disk cache is off
+// unless KIRIGAMI_ICON_DISK_CACHE_SIZE is set
+static constexpr qint64 s_defaultDiskCacheSize = 0;
+
+// Trim the disk cache after this many images were written to it
+static constexpr int s_diskCacheTrimInterval = 64;
+
+static QString diskCacheDirectory()
+{
+    static const QString directory = [] {
+        // Per application: entries are not revalidated, so one application
+        // must not be served what another one downloaded.
+        const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        return cacheDir.isEmpty() ? QString() : cacheDir + QStringLiteral("/kirigami/icons/");
+    }();
+    return directory;
+}
+
+QThreadPool *IconImageLoader::threadPool()
+{
+    static QThreadPool *pool = [] {
+        auto pool = new QThreadPool(qApp);
+        pool->setObjectName(QStringLiteral("IconImageLoader"));
+        // Decoding is mostly waiting for the disk, don't compete with
+        // rendering for all cores.
+        pool->setMaxThreadCount(std::clamp(QThread::idealThreadCount() / 2, 1, 4));
+        return pool;
+    }();
+    return pool;
+}
+
+void IconImageLoader::track(const IconImageCache::Key &key, const QFuture<QImage> &future)
+{
+    s_pending.insert(key, future);
+
+    auto watcher = new QFutureWatcher<QImage>(qApp);
+    QObject::connect(watcher, &QFutureWatcherBase::finished, watcher, [key, watcher]() {
+        s_pending.remove(key);
+        IconImageCache::insert(key, watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(future);
+}
+
+QFuture<QImage> IconImageLoader::load(const IconImageCache::Key &key, std::function<QImage()> decode)
+{
+    if (auto it = s_pending.constFind(key); it != s_pending.constEnd()) {
+        return *it;
+    }
+
+    auto promise = std::make_shared<QPromise<QImage>>();
+    QFuture<QImage> future = promise->future();
+    promise->start();
+
+    threadPool()->start([promise, decode = std::move(decode)]() {
+        promise->addResult(decode());
+        promise->finish();
+    });
+
+    track(key, future);
+    return future;
+}
+
+QFuture<QImage> IconImageLoader::loadRemote(QNetworkAccessManager *manager, const QUrl &url, const IconImageCache::Key &key)
+{
+    if (auto it = s_pending.constFind(key); it != s_pending.constEnd()) {
+        return *it;
+    }
+
+    const QString cacheFile = diskCacheFile(key);
+    if (!cacheFile.isEmpty() && QFile::exists(cacheFile)) {
+        return load(key, [cacheFile, devicePixelRatio = key.devicePixelRatio]() {
+            return readDiskCache(cacheFile, devicePixelRatio);
+        });
+    }
+
+    auto promise = std::make_shared<QPromise<QImage>>();
+    QFuture<QImage> future = promise->future();
+    promise->start();
+    track(key, future);
+
+    Download &download = s_downloads[url];
+    download.requests.append(RemoteRequest{key, cacheFile, promise});
+    if (download.reply) {
+        return future;
+    }
+
+    QNetworkRequest request(url);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    QNetworkReply *reply = manager->get(request);
+    download.reply = reply;
+
+    QObject::connect(reply, &QNetworkReply::finished, reply, [url, reply]() {
+        reply->deleteLater();
+        finishDownload(url, reply->error() == QNetworkReply::NoError ? reply->readAll() : QByteArray());
+    });
+    // The reply goes away without finishing when its manager is deleted
+    QObject::connect(reply, &QObject::destroyed, qApp, [url]() {
+        if (s_downloads.contains(url) && !s_downloads.value(url).reply) {
+            finishDownload(url, QByteArray());
+        }
+    });
+
+    return future;
+}
+
+void IconImageLoader::finishDownload(const QUrl &url, const QByteArray &data)
+{
+    const QList<RemoteRequest> requests = s_downloads.take(url).requests;
+    for (const auto &request : requests) {
+        threadPool()->start([request, data]() {
+            QBuffer buffer;
+            buffer.setData(data);
+            QImageReader reader(&buffer);
+            const QImage image = decode(reader, request.key.size, request.key.devicePixelRatio, true);
+            if (!image.isNull() && !request.cacheFile.isEmpty()) {
+                writeDiskCache(request.cacheFile, image);
+            }
+            request.promise->addResult(image);
+            request.promise->finish();
+        });
+    }
+}
+
+QImage IconImageLoader::decodeFile(const QString &path, QSize size, qreal devicePixelRatio)
+{
+    QImageReader reader(path);
+    return decode(reader, size, devicePixelRatio, false);
+}
+
+QImage IconImageLoader::decode(QImageReader &reader, QSize size, qreal devicePixelRatio, bool scaleUp)
+{
+    const QSize pixelSize = (QSizeF(size) * devicePixelRatio).toSize();
+
+    QSize imageSize = reader.size();
+    const bool scalable = reader.format() == "svg" || reader.format() == "svgz";
+    if (imageSize.isValid() && pixelSize.isValid()
+        && (scaleUp || scalable || imageSize.width() > pixelSize.width() || imageSize.height() > pixelSize.height())) {
+        imageSize.scale(pixelSize, Qt::KeepAspectRatio);
+        reader.setScaledSize(imageSize);
+    }
+
+    QImage image = reader.read();
+    image.setDevicePixelRatio(devicePixelRatio);
+    return image;
+}
+
+qint64 IconImageLoader::diskCacheSize()
+{
+    static const qint64 size = [] {
+        bool ok = false;
+        const int size = qEnvironmentVariableIntValue("KIRIGAMI_ICON_DISK_CACHE_SIZE", &ok);
+        return (ok ? std::max(0, size) : s_defaultDiskCacheSize) * 1024;
+    }();
+    return size;
+}
+
+QString IconImageLoader::diskCacheFile(const IconImageCache::Key &key)
+{
+    const QString directory = diskCacheDirectory();
+    if (diskCacheSize() == 0 || directory.isEmpty()) {
+        return QString();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(key.name.toUtf8());
+    hash.addData(QByteArray::number(key.size.width()) + 'x' + QByteArray::number(key.size.height()) + '@' + QByteArray::number(key.devicePixelRatio));
+    return directory + QString::fromLatin1(hash.result().toHex()) + QStringLiteral(".png");
+}
+
+QImage IconImageLoader::readDiskCache(const QString &path, qreal devicePixelRatio)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QImage();
+    }
+
+    QImage image;
+    if (!image.load(&file, "png")) {
+        file.remove();
+        return QImage();
+    }
+
+    // Keeps recently used images when trimming
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    image.setDevicePixelRatio(devicePixelRatio);
+    return image;
+}
+
+void IconImageLoader::writeDiskCache(const QString &path, const QImage &image)
+{
+    QDir().mkpath(diskCacheDirectory());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || !image.save(&file, "png") || !file.commit()) {
+        return;
+    }
+
+    if (s_diskCacheWrites++ % s_diskCacheTrimInterval == 0) {
+        trimDiskCache();
+    }
+}
+
+void IconImageLoader::trimDiskCache()
+{
+    static QMutex mutex;
+    if (!mutex.tryLock()) {
+        return; // Another thread is already at it
+    }
+
+    const auto entries = QDir(diskCacheDirectory()).entryInfoList({QStringLiteral("*.png")}, QDir::Files, QDir::Time);
+
+    qint64 total = 0;
+    for (const QFileInfo &entry : entries) {
+        total += entry.size();
+        if (total > diskCacheSize()) {
+            QFile::remove(entry.absoluteFilePath());
+        }
+    }
+
+    mutex.unlock();
+}
@@ -0,0 +1,93 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QFuture>
+#include <QHash>
+#include <QImage>
+#include <QPointer>
+#include <QPromise>
+#include <QUrl>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "iconimagecache.h"
+
+class QImageReader;
+class QNetworkAccessManager;
+class QNetworkReply;
+class QThreadPool;
+
+/*
+ * Decodes icon images on worker threads for Icon's asynchronous mode.
+ *
+ * Requests are identified by the key the result is stored under in
+ * IconImageCache. A request for a key that is already being decoded shares
+ * the pending result instead of decoding again. Only used from the GUI thread,
+ * apart from the decode functions themselves.
+ *
+ * Remote images are downloaded once per URL, however many sizes are
+ * requested. They can also be kept decoded at each requested size in a disk
+ * cache of the application. Its entries are never revalidated with the
+ * server, so it is disabled unless its size, in KiB, is set with the
+ * KIRIGAMI_ICON_DISK_CACHE_SIZE environment variable. Without it, downloads
+ * go through the cache of the network access manager, if it has one.
+ */
+class IconImageLoader
+{
+public:
+    /*
+     * @returns the pending result of @p decode, which is run on a worker
+     * thread and must not touch anything but its captured values. Finished
+     * results are added to IconImageCache.
+     */
+    static QFuture<QImage> load(const IconImageCache::Key &key, std::function<QImage()> decode);
+
+    /*
+     * @returns the pending result of loading the image at @p url with
+     * @p manager, decoded at the size and device pixel ratio of @p key.
+     * Images in the disk cache are decoded from there instead.
+     */
+    static QFuture<QImage> loadRemote(QNetworkAccessManager *manager, const QUrl &url, const IconImageCache::Key &key);
+
+    /*
+     * Decodes the image file at @p path, at the size an icon of @p size
+     * logical pixels would be rendered at. Raster images are not scaled up.
+     * Safe to call from any thread.
+     */
+    static QImage decodeFile(const QString &path, QSize size, qreal devicePixelRatio);
+
+private:
+    struct RemoteRequest {
+        IconImageCache::Key key;
+        QString cacheFile;
+        std::shared_ptr<QPromise<QImage>> promise;
+    };
+    struct Download {
+        QPointer<QNetworkReply> reply;
+        QList<RemoteRequest> requests;
+    };
+
+    static QThreadPool *threadPool();
+    static void track(const IconImageCache::Key &key, const QFuture<QImage> &future);
+    static void finishDownload(const QUrl &url, const QByteArray &data);
+
+    // Scales to fit @p size if @p scaleUp, only down otherwise
+    static QImage decode(QImageReader &reader, QSize size, qreal devicePixelRatio, bool scaleUp);
+
+    static qint64 diskCacheSize();
+    static QString diskCacheFile(const IconImageCache::Key &key);
+    static QImage readDiskCache(const QString &path, qreal devicePixelRatio);
+    static void writeDiskCache(const QString &path, const QImage &image);
+    static void trimDiskCache();
+
+    inline static QHash<IconImageCache::Key, QFuture<QImage>> s_pending;
+    inline static QHash<QUrl, Download> s_downloads;
+    inline static std::atomic<int> s_diskCacheWrites = 0;
+};
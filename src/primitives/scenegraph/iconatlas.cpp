@@ -0,0 +1,424 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "iconatlas.h"
+
+#include <QMutexLocker>
+#include <QPainter>
+#include <QVarLengthArray>
+#include <rhi/qrhi.h>
+
+#include <array>
+#include <cmath>
+
+#include "texturecache.h"
+
+static constexpr int s_defaultPageSize = 1024;
+
+// Units::iconSizes, from small to enormous
+static constexpr std::array<int, 6> s_bucketSizes = {16, 22, 32, 48, 64, 128};
+
+// Space around each slot, filled with the edge pixels of the image so that
+// linear filtering does not blend in the neighbouring icons.
+static constexpr int s_padding = 1;
+
+// @returns the height of the shelf for @p image, or 0 if it is too large
+static int shelfHeight(const QImage &image)
+{
+    const qreal devicePixelRatio = image.devicePixelRatio();
+    for (int size : s_bucketSizes) {
+        const int height = std::ceil(size * devicePixelRatio) + 2 * s_padding;
+        if (image.height() + 2 * s_padding <= height) {
+            return height;
+        }
+    }
+    return 0;
+}
+
+class IconAtlasPage
+{
+public:
+    IconAtlasPage(QQuickWindow *window, int size)
+        : m_window(window)
+        , m_image(size, size, QImage::Format_ARGB32_Premultiplied)
+    {
+        m_image.fill(Qt::transparent);
+    }
+
+    QQuickWindow *window() const
+    {
+        return m_window;
+    }
+
+    QSize size() const
+    {
+        return m_image.size();
+    }
+
+    QRhiTexture *rhiTexture() const
+    {
+        return m_texture.get();
+    }
+
+    const QImage &image() const
+    {
+        return m_image;
+    }
+
+    /*
+     * @returns the area reserved for an image of @p size on a shelf of
+     * @p height, or an empty rectangle if the page is full.
+     */
+    QRect allocate(QSize size, int height)
+    {
+        const int width = size.width() + 2 * s_padding;
+
+        Shelf *emptyShelf = nullptr;
+        for (auto &shelf : m_shelves) {
+            if (shelf.slots == 0 && shelf.height >= height && !emptyShelf) {
+                emptyShelf = &shelf;
+            }
+            if (shelf.height != height) {
+                continue;
+            }
+            for (auto it = shelf.freeSlots.begin(); it != shelf.freeSlots.end(); ++it) {
+                if (it->second >= width) {
+                    const int x = it->first;
+                    if (it->second > width) {
+                        *it = {x + width, it->second - width};
+                    } else {
+                        shelf.freeSlots.erase(it);
+                    }
+                    return reserve(shelf, x, size);
+                }
+            }
+            if (m_image.width() - shelf.used >= width) {
+                const int x = shelf.used;
+                shelf.used += width;
+                return reserve(shelf, x, size);
+            }
+        }
+
+        if (emptyShelf && m_image.width() >= width) {
+            emptyShelf->used = width;
+            return reserve(*emptyShelf, 0, size);
+        }
+
+        const int y = m_shelves.isEmpty() ? 0 : m_shelves.last().y + m_shelves.last().height;
+        if (y + height > m_image.height() || width > m_image.width()) {
+            return QRect();
+        }
+
+        m_shelves.append(Shelf{.y = y, .height = height, .used = width});
+        return reserve(m_shelves.last(), 0, size);
+    }
+
+    void release(const QRect &rect)
+    {
+        const int y = rect.y() - s_padding;
+        auto shelf = std::find_if(m_shelves.begin(), m_shelves.end(), [y](const Shelf &shelf) {
+            return shelf.y == y;
+        });
+        if (shelf == m_shelves.end()) {
+            return;
+        }
+
+        if (--shelf->slots > 0) {
+            // Merge with the free neighbours, so that wider images fit in
+            // again once all icons in between are gone.
+            int x = rect.x() - s_padding;
+            int width = rect.width() + 2 * s_padding;
+            for (auto it = shelf->freeSlots.begin(); it != shelf->freeSlots.end();) {
+                if (it->first + it->second == x) {
+                    x = it->first;
+                    width += it->second;
+                    it = shelf->freeSlots.erase(it);
+                } else if (x + width == it->first) {
+                    width += it->second;
+                    it = shelf->freeSlots.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            if (x + width == shelf->used) {
+                shelf->used = x;
+            } else {
+                shelf->freeSlots.append({x, width});
+            }
+            return;
+        }
+
+        shelf->used = 0;
+        shelf->freeSlots.clear();
+        while (!m_shelves.isEmpty() && m_shelves.last().slots == 0) {
+            m_shelves.removeLast();
+        }
+    }
+
+    void upload(const QImage &image, const QRect &rect)
+    {
+        const int width = rect.width();
+        const int height = rect.height();
+
+        QPainter painter(&m_image);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(rect, image, image.rect());
+        painter.drawImage(QRect(rect.x() - 1, rect.y(), 1, height), image, QRect(0, 0, 1, height));
+        painter.drawImage(QRect(rect.right() + 1, rect.y(), 1, height), image, QRect(width - 1, 0, 1, height));
+        painter.drawImage(QRect(rect.x(), rect.y() - 1, width, 1), image, QRect(0, 0, width, 1));
+        painter.drawImage(QRect(rect.x(), rect.bottom() + 1, width, 1), image, QRect(0, height - 1, width, 1));
+        painter.end();
+
+        m_dirtyRects.append(rect.adjusted(-s_padding, -s_padding, s_padding, s_padding));
+    }
+
+    /*
+     * Records the uploads of what changed since the last call in
+     * @p resourceUpdates. The texture is created and filled with the first
+     * call, later calls only upload the areas images were placed in.
+     */
+    void commitTextureOperations(QRhi *rhi, QRhiResourceUpdateBatch *resourceUpdates)
+    {
+        if (!m_texture) {
+            m_format = QRhiTexture::RGBA8;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+            // The memory layout of QImage::Format_ARGB32_Premultiplied
+            if (rhi->isTextureFormatSupported(QRhiTexture::BGRA8)) {
+                m_format = QRhiTexture::BGRA8;
+            }
+#endif
+            m_texture.reset(rhi->newTexture(m_format, m_image.size()));
+            if (!m_texture->create()) {
+                m_texture.reset();
+                return;
+            }
+            resourceUpdates->uploadTexture(m_texture.get(), uploadImage(m_image));
+            m_dirtyRects.clear();
+            return;
+        }
+
+        if (m_dirtyRects.isEmpty()) {
+            return;
+        }
+
+        QVarLengthArray<QRhiTextureUploadEntry, 16> entries;
+        for (const QRect &rect : std::as_const(m_dirtyRects)) {
+            QRhiTextureSubresourceUploadDescription description(uploadImage(m_image.copy(rect)));
+            description.setDestinationTopLeft(rect.topLeft());
+            entries.append(QRhiTextureUploadEntry(0, 0, description));
+        }
+        QRhiTextureUploadDescription description;
+        description.setEntries(entries.cbegin(), entries.cend());
+        resourceUpdates->uploadTexture(m_texture.get(), description);
+        m_dirtyRects.clear();
+    }
+
+private:
+    struct Shelf {
+        int y = 0;
+        int height = 0;
+        // End of the last slot ever reserved on this shelf
+        int used = 0;
+        int slots = 0;
+        // Position and width of slots that were released since
+        QList<std::pair<int, int>> freeSlots;
+    };
+
+    QRect reserve(Shelf &shelf, int x, QSize size)
+    {
+        ++shelf.slots;
+        return QRect(QPoint(x + s_padding, shelf.y + s_padding), size);
+    }
+
+    QImage uploadImage(const QImage &image) const
+    {
+        return m_format == QRhiTexture::BGRA8 ? image : image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+    }
+
+    QQuickWindow *m_window;
+    // What the texture holds, kept to upload changed areas and for
+    // IconAtlasTexture::removedFromAtlas()
+    QImage m_image;
+    std::unique_ptr<QRhiTexture> m_texture;
+    QRhiTexture::Format m_format = QRhiTexture::RGBA8;
+    // Areas of m_image not uploaded yet, including the padding
+    QList<QRect> m_dirtyRects;
+    QList<Shelf> m_shelves;
+};
+
+/*
+ * A part of an atlas page. All textures of a page have the same comparison
+ * key, which is what lets the renderer merge their nodes.
+ */
+class IconAtlasTexture : public QSGTexture
+{
+public:
+    IconAtlasTexture(const std::shared_ptr<IconAtlasPage> &page, const QRect &rect)
+        : m_page(page)
+        , m_rect(rect)
+    {
+    }
+
+    ~IconAtlasTexture() override
+    {
+        m_page->release(m_rect);
+    }
+
+    qint64 comparisonKey() const override
+    {
+        return qint64(quintptr(m_page.get()));
+    }
+
+    QRhiTexture *rhiTexture() const override
+    {
+        return m_page->rhiTexture();
+    }
+
+    QSize textureSize() const override
+    {
+        return m_rect.size();
+    }
+
+    bool hasAlphaChannel() const override
+    {
+        return true;
+    }
+
+    bool hasMipmaps() const override
+    {
+        return false;
+    }
+
+    bool isAtlasTexture() const override
+    {
+        return true;
+    }
+
+    QRectF normalizedTextureSubRect() const override
+    {
+        const QSizeF pageSize = m_page->size();
+        return QRectF(m_rect.x() / pageSize.width(), m_rect.y() / pageSize.height(), m_rect.width() / pageSize.width(), m_rect.height() / pageSize.height());
+    }
+
+    QSGTexture *removedFromAtlas(QRhiResourceUpdateBatch *resourceUpdates) const override
+    {
+        Q_UNUSED(resourceUpdates);
+        if (!m_standalone) {
+            m_standalone.reset(m_page->window()->createTextureFromImage(m_page->image().copy(m_rect)));
+        }
+        return m_standalone.get();
+    }
+
+    void commitTextureOperations(QRhi *rhi, QRhiResourceUpdateBatch *resourceUpdates) override
+    {
+        m_page->commitTextureOperations(rhi, resourceUpdates);
+    }
+
+private:
+    std::shared_ptr<IconAtlasPage> m_page;
+    QRect m_rect;
+    mutable std::unique_ptr<QSGTexture> m_standalone;
+};
+
+IconAtlas::IconAtlas(QQuickWindow *window)
+    : m_window(window)
+    , m_textures(std::make_shared<QHash<qint64, std::weak_ptr<QSGTexture>>>())
+{
+    m_invalidatedConnection = QObject::connect(
+        window,
+        &QQuickWindow::sceneGraphInvalidated,
+        window,
+        [this]() {
+            {
+                QMutexLocker locker(&s_mutex);
+                s_atlases.remove(m_window);
+            }
+            delete this;
+        },
+        Qt::DirectConnection);
+}
+
+IconAtlas::~IconAtlas()
+{
+    QObject::disconnect(m_invalidatedConnection);
+}
+
+int IconAtlas::pageSize()
+{
+    static const int size = [] {
+        bool ok = false;
+        const int size = qEnvironmentVariableIntValue("KIRIGAMI_ICON_ATLAS_SIZE", &ok);
+        return ok ? std::max(0, size) : s_defaultPageSize;
+    }();
+    return size;
+}
+
+std::shared_ptr<QSGTexture> IconAtlas::loadTexture(QQuickWindow *window, const QImage &image)
+{
+    if (image.isNull()) {
+        return nullptr;
+    }
+
+    const int height = shelfHeight(image);
+    if (height == 0 || height > pageSize() || image.width() + 2 * s_padding > pageSize()) {
+        return TextureCache::loadTexture(window, image, QQuickWindow::TextureCanUseAtlas);
+    }
+
+    IconAtlas *atlas = nullptr;
+    {
+        QMutexLocker locker(&s_mutex);
+        atlas = s_atlases.value(window);
+        if (!atlas) {
+            atlas = new IconAtlas(window);
+            s_atlases.insert(window, atlas);
+        }
+    }
+
+    return atlas->texture(image, height);
+}
+
+std::shared_ptr<QSGTexture> IconAtlas::texture(const QImage &image, int shelfHeight)
+{
+    const qint64 key = image.cacheKey();
+    if (auto texture = m_textures->value(key).lock()) {
+        return texture;
+    }
+
+    std::shared_ptr<IconAtlasPage> page;
+    QRect rect;
+    for (auto it = m_pages.begin(); it != m_pages.end();) {
+        page = it->lock();
+        if (!page) {
+            it = m_pages.erase(it);
+            continue;
+        }
+        rect = page->allocate(image.size(), shelfHeight);
+        if (!rect.isEmpty()) {
+            break;
+        }
+        ++it;
+    }
+
+    if (rect.isEmpty()) {
+        page = std::make_shared<IconAtlasPage>(m_window, pageSize());
+        m_pages.append(page);
+        rect = page->allocate(image.size(), shelfHeight);
+    }
+
+    page->upload(image, rect);
+
+    std::weak_ptr<QHash<qint64, std::weak_ptr<QSGTexture>>> textures = m_textures;
+    auto cleanAndDelete = [textures, key](QSGTexture *texture) {
+        if (auto hash = textures.lock()) {
+            hash->remove(key);
+        }
+        delete texture;
+    };
+    auto texture = std::shared_ptr<QSGTexture>(new IconAtlasTexture(page, rect), cleanAndDelete);
+    m_textures->insert(key, texture);
+    return texture;
+}
@@ -0,0 +1,69 @@
+/*
+ *  SPDX-FileCopyrightText: 2026 KDE Contributors
+ *
+ *  SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QQuickWindow>
+#include <QSGTexture>
+
+#include <memory>
+
+class IconAtlasPage;
+
+/*
+ * Packs icon images into a few large textures per window, so that icons
+ * sharing a shader and its uniforms also share a texture and the renderer
+ * can draw them in a single batch.
+ *
+ * Images are placed on shelves whose heights follow the standard icon sizes
+ * of Units::iconSizes, scaled by the device pixel ratio of the image. Larger
+ * images go through TextureCache instead.
+ *
+ * Each page is a single texture for as long as the page exists. Images placed
+ * on it are uploaded as sub-rectangles, along with the other resource updates
+ * of the next frame.
+ *
+ * A slot is freed once the last node using it is gone. Adjacent free slots
+ * are merged and reused for images of the same height, fully freed shelves
+ * for any height that fits, and empty pages are released. Pages are not
+ * compacted: moving an image would need every node showing it to update its
+ * texture coordinates. A fragmented page goes away with its last image.
+ *
+ * Only used from the render thread of the window. The size of a page, in
+ * pixels, can be set with the KIRIGAMI_ICON_ATLAS_SIZE environment variable;
+ * 0 disables the atlas.
+ */
+class IconAtlas
+{
+public:
+    /*
+     * @returns a texture for @p image in the atlas of @p window, or one from
+     * TextureCache if the image does not fit in the atlas.
+     *
+     * As with TextureCache, the same image gets the same texture.
+     */
+    static std::shared_ptr<QSGTexture> loadTexture(QQuickWindow *window, const QImage &image);
+
+private:
+    explicit IconAtlas(QQuickWindow *window);
+    ~IconAtlas();
+
+    std::shared_ptr<QSGTexture> texture(const QImage &image, int shelfHeight);
+
+    static int pageSize();
+
+    QQuickWindow *m_window;
+    QList<std::weak_ptr<IconAtlasPage>> m_pages;
+    // Shared with the texture deleters, which may outlive the atlas
+    std::shared_ptr<QHash<qint64, std::weak_ptr<QSGTexture>>> m_textures;
+    QMetaObject::Connection m_invalidatedConnection;
+
+    inline static QMutex s_mutex;
+    inline static QHash<QQuickWindow *, IconAtlas *> s_atlases;
+};
@@ -9,6 +9,26 @@
 #include <array>
 #include <cstring>
 
+void IconMaterial::setMixAmount(float mixAmount, bool animating)
+{
+    if (uniformData().size() < qsizetype(sizeof(float) * 18)) {
+        return;
+    }
+
+    // After the matrix and opacity
+    memcpy(uniformData().data() + sizeof(float) * 17, &mixAmount, sizeof(float));
+    m_animating = animating;
+}
+
+int IconMaterial::compare(const QSGMaterial *other) const
+{
+    if (m_animating || static_cast<const IconMaterial *>(other)->m_animating) {
+        return QSGMaterial::compare(other);
+    }
+
+    return ShaderMaterial::compare(other);
+}
+
 void IconMaterial::updateRenderStateUniforms(const QSGMaterialShader::RenderState &state)
 {
     const auto viewport = state.viewportRect();
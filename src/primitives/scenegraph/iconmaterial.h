@@ -13,6 +13,18 @@ class IconMaterial : public ShaderMaterial
 public:
     using ShaderMaterial::ShaderMaterial;
 
+    /*
+     * Set the mix_amount uniform. While \a animating, the material never
+     * compares equal to another one, so that it is neither batched with
+     * other icons nor skipped when uploading uniforms.
+     */
+    void setMixAmount(float mixAmount, bool animating);
+
+    int compare(const QSGMaterial *other) const override;
+
 protected:
     void updateRenderStateUniforms(const QSGMaterialShader::RenderState &state) override;
+
+private:
+    bool m_animating = false;
 };
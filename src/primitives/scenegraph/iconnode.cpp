@@ -6,9 +6,77 @@
 
 #include "iconnode.h"
 
+#include <QQuickWindow>
+
+#include <algorithm>
+
 #include "iconmaterial.h"
 
+void IconNode::startMixAnimation(QQuickWindow *window, int duration, const QEasingCurve &easing, const std::shared_ptr<std::atomic_bool> &finished)
+{
+    m_window = window;
+    m_duration = duration;
+    m_easing = easing;
+    m_finished = finished;
+    m_timer.invalidate();
+    m_animating = true;
+    setMixAmount(0.0);
+}
+
+void IconNode::stopMixAnimation()
+{
+    if (!m_animating) {
+        return;
+    }
+
+    m_animating = false;
+    setMixAmount(1.0);
+
+    if (m_finished) {
+        *m_finished = true;
+        m_finished.reset();
+    }
+}
+
+bool IconNode::isAnimating() const
+{
+    return m_animating;
+}
+
+void IconNode::preprocess()
+{
+    ShaderNode::preprocess();
+
+    if (!m_animating) {
+        return;
+    }
+
+    if (!m_timer.isValid()) {
+        m_timer.start();
+    }
+
+    const qreal progress = m_duration > 0 ? std::min(1.0, m_timer.elapsed() / qreal(m_duration)) : 1.0;
+    if (progress < 1.0) {
+        setMixAmount(m_easing.valueForProgress(progress));
+        // Renders the next frame without waiting for the GUI thread
+        m_window->update();
+    } else {
+        stopMixAnimation();
+    }
+}
+
 QSGMaterial *IconNode::createMaterialVariant(QSGMaterialType *variant)
 {
     return new IconMaterial(variant);
 }
+
+void IconNode::setMixAmount(float mixAmount)
+{
+    auto iconMaterial = static_cast<IconMaterial *>(material());
+    if (!iconMaterial) {
+        return;
+    }
+
+    iconMaterial->setMixAmount(mixAmount, m_animating);
+    markDirty(QSGNode::DirtyMaterial);
+}
@@ -6,6 +6,12 @@
 
 #pragma once
 
+#include <QEasingCurve>
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <memory>
+
 #include "shadernode.h"
 
 class IconNode : public ShaderNode
@@ -13,6 +19,40 @@ class IconNode : public ShaderNode
 public:
     IconNode() = default;
 
+    /*
+     * Blend from the texture of channel 1 to the one of channel 0 over
+     * \a duration milliseconds, starting with the next frame.
+     *
+     * The blend is driven from preprocess() on the render thread, which
+     * schedules frames of \a window until it is done, so that it keeps
+     * running at display rate while the GUI thread is busy. \a finished is
+     * set once the blend is done or stopped.
+     */
+    void startMixAnimation(QQuickWindow *window, int duration, const QEasingCurve &easing, const std::shared_ptr<std::atomic_bool> &finished);
+
+    /*
+     * Stop blending and show the texture of channel 0 only.
+     */
+    void stopMixAnimation();
+
+    /*
+     * Whether a blend started with startMixAnimation() is still running.
+     */
+    bool isAnimating() const;
+
+    void preprocess() override;
+
 protected:
     QSGMaterial *createMaterialVariant(QSGMaterialType *variant) override;
+
+private:
+    void setMixAmount(float mixAmount);
+
+    QQuickWindow *m_window = nullptr;
+    QEasingCurve m_easing;
+    int m_duration = 0;
+    std::shared_ptr<std::atomic_bool> m_finished;
+    // Started with the first frame of the animation
+    QElapsedTimer m_timer;
+    bool m_animating = false;
 };
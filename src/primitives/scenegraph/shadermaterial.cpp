@@ -43,13 +43,29 @@ QSGMaterialType *ShaderMaterial::type() const
 int ShaderMaterial::compare(const QSGMaterial *other) const
 {
     auto material = static_cast<const ShaderMaterial *>(other);
-    if (m_uniformData == material->m_uniformData && m_textures == material->m_textures) {
+    if (m_uniformData == material->m_uniformData && hasSameTextures(material)) {
         return 0;
     }
 
     return QSGMaterial::compare(other);
 }
 
+bool ShaderMaterial::hasSameTextures(const ShaderMaterial *other) const
+{
+    if (m_textures.size() != other->m_textures.size()) {
+        return false;
+    }
+
+    // Different parts of the same atlas texture can be drawn in one batch
+    for (auto [binding, texture] : m_textures.asKeyValueRange()) {
+        QSGTexture *otherTexture = other->m_textures.value(binding);
+        if (texture != otherTexture && (!texture || !otherTexture || texture->comparisonKey() != otherTexture->comparisonKey())) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void ShaderMaterial::setUniformBufferSize(qsizetype size)
 {
     if (size == m_uniformData.size()) {
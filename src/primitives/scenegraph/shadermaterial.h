@@ -47,6 +47,8 @@ protected:
     virtual void updateRenderStateUniforms(const QSGMaterialShader::RenderState &state);
 
 private:
+    bool hasSameTextures(const ShaderMaterial *other) const;
+
     QString m_name;
     QSGMaterialType *m_type;
 
@@ -155,8 +155,17 @@ void ShaderNode::setTexture(TextureChannel channel, const QImage &image, QQuickW
         return;
     }
 
-    auto texture = TextureCache::loadTexture(window, image, options);
-    if (!texture) {
+    setTexture(channel, TextureCache::loadTexture(window, image, options), options);
+}
+
+void ShaderNode::setTexture(TextureChannel channel, const std::shared_ptr<QSGTexture> &texture)
+{
+    setTexture(channel, texture, {});
+}
+
+void ShaderNode::setTexture(TextureChannel channel, const std::shared_ptr<QSGTexture> &texture, QQuickWindow::CreateTextureOptions options)
+{
+    if (!m_shaderMaterial || !texture) {
         return;
     }
 
@@ -103,6 +103,14 @@ public:
      */
     void setTexture(TextureChannel channel, const QImage &image, QQuickWindow *window, QQuickWindow::CreateTextureOptions options = {});
 
+    /*
+     * Set the texture for a channel to an existing texture.
+     *
+     * This is used for textures that are managed elsewhere, like the ones
+     * from IconAtlas. The node keeps \a texture alive while it uses it.
+     */
+    void setTexture(TextureChannel channel, const std::shared_ptr<QSGTexture> &texture);
+
     /*
      * Set the texture for a channel to a texture provider.
      *
@@ -146,6 +154,7 @@ protected:
     virtual QSGMaterial *createMaterialVariant(QSGMaterialType *variant);
 
 private:
+    void setTexture(TextureChannel channel, const std::shared_ptr<QSGTexture> &texture, QQuickWindow::CreateTextureOptions options);
     void preprocessTexture(const TextureInfo &texture);
 
     QRectF m_rect;